@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2012-2016 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#include <yaul.h>
+
+#include <stdlib.h>
+
+#include "retained.h"
+
+#define CMDT_WORDS      (sizeof(vdp1_cmdt_t) / sizeof(uint16_t))
+
+#define DIRTY_COUNT(count) (((uint32_t)(count) + 31) / 32)
+
+static void _cmdt_write(retained_list_t *, uint16_t, bool);
+
+/* Nothing is considered to be in VDP1 VRAM yet, so the first upload should
+ * be a full one */
+void
+retained_list_init(retained_list_t *retained, vdp1_cmdt_list_t *cmdt_list,
+    uint16_t vram_index)
+{
+        const uint16_t count = cmdt_list->count;
+
+        retained->cmdt_list = cmdt_list;
+        retained->vram_index = vram_index;
+        retained->count = count;
+        retained->words = 0;
+        retained->cmdts = 0;
+
+        retained->shadow = malloc(count * sizeof(vdp1_cmdt_t));
+        retained->dirty = malloc(DIRTY_COUNT(count) * sizeof(uint32_t));
+
+        (void)memset(retained->shadow, 0x00, count * sizeof(vdp1_cmdt_t));
+        (void)memset(retained->dirty, 0x00, DIRTY_COUNT(count) * sizeof(uint32_t));
+}
+
+void
+retained_cmdt_dirty(retained_list_t *retained, uint16_t index)
+{
+        if (index >= retained->count) {
+                return;
+        }
+
+        retained->dirty[index >> 5] |= 1UL << (index & 31);
+}
+
+/* Must only be called while the VDP1 is not reading the list, that is once
+ * vdp1_sync_wait() returned */
+void
+retained_list_upload(retained_list_t *retained)
+{
+        uint32_t i;
+
+        retained->words = 0;
+        retained->cmdts = 0;
+
+        for (i = 0; i < DIRTY_COUNT(retained->count); i++) {
+                uint32_t dirty = retained->dirty[i];
+                uint16_t index = i << 5;
+
+                retained->dirty[i] = 0;
+
+                for (; dirty != 0; dirty >>= 1, index++) {
+                        if ((dirty & 1) != 0) {
+                                _cmdt_write(retained, index, false);
+                        }
+                }
+        }
+}
+
+/* Write every word of every command, dirty or not */
+void
+retained_list_upload_full(retained_list_t *retained)
+{
+        uint16_t index;
+
+        retained->words = 0;
+        retained->cmdts = 0;
+
+        for (index = 0; index < retained->count; index++) {
+                _cmdt_write(retained, index, true);
+        }
+
+        (void)memset(retained->dirty, 0x00,
+            DIRTY_COUNT(retained->count) * sizeof(uint32_t));
+}
+
+static void
+_cmdt_write(retained_list_t *retained, uint16_t index, bool full)
+{
+        const uint16_t * const words =
+            (const uint16_t *)&retained->cmdt_list->cmdts[index];
+        uint16_t * const shadow = (uint16_t *)&retained->shadow[index];
+        volatile uint16_t * const vram = (volatile uint16_t *)VDP1_VRAM(
+                (retained->vram_index + index) * sizeof(vdp1_cmdt_t));
+
+        const uint32_t written = retained->words;
+        uint32_t w;
+
+        for (w = 0; w < CMDT_WORDS; w++) {
+                if (!full && (words[w] == shadow[w])) {
+                        continue;
+                }
+
+                shadow[w] = words[w];
+                vram[w] = words[w];
+
+                retained->words++;
+        }
+
+        if (retained->words != written) {
+                retained->cmdts++;
+        }
+}
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2012-2016 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#ifndef RETAINED_H_
+#define RETAINED_H_
+
+#include <yaul.h>
+
+/* A command list kept in VDP1 VRAM across frames. Commands are edited in
+ * cmdt_list with the usual vdp1_cmdt_*() calls, then marked dirty. An
+ * upload compares each dirty command against a shadow of VDP1 VRAM and
+ * writes only the words that changed */
+typedef struct {
+        vdp1_cmdt_list_t *cmdt_list;
+        uint16_t vram_index;    /* First command in VDP1 VRAM */
+        uint16_t count;
+        uint32_t words;         /* Words written by the last upload */
+        uint32_t cmdts;         /* Commands written by the last upload */
+
+        /* Private */
+        vdp1_cmdt_t *shadow;
+        uint32_t *dirty;
+} retained_list_t;
+
+extern void retained_list_init(retained_list_t *retained,
+    vdp1_cmdt_list_t *cmdt_list, uint16_t vram_index);
+extern void retained_cmdt_dirty(retained_list_t *retained, uint16_t index);
+extern void retained_list_upload(retained_list_t *retained);
+extern void retained_list_upload_full(retained_list_t *retained);
+
+#endif /* !RETAINED_H_ */
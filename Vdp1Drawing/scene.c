@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2012-2016 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#include <yaul.h>
+
+#include "scene.h"
+
+#define HEADER_SIZE             (8)
+#define BATCH_HEADER_SIZE       (6)
+#define CASE_SIZE               (8)
+
+/* Words are big endian, and are not always aligned */
+static inline uint16_t
+_u16_get(const uint8_t *bytes)
+{
+        return (bytes[0] << 8) | bytes[1];
+}
+
+static inline const uint8_t *
+_batch_next_get(const uint8_t *batch)
+{
+        return &batch[BATCH_HEADER_SIZE + (batch[1] * CASE_SIZE)];
+}
+
+/* Returns false when data is not a scene, or has no case. The batches are
+ * walked once, so that scene_next() never has to check them */
+bool
+scene_init(scene_t *scene, const void *data)
+{
+        const uint8_t * const bytes = data;
+
+        if ((bytes[0] != 'S') || (bytes[1] != 'C') || (bytes[2] != 'N') ||
+            (bytes[3] != '1')) {
+                return false;
+        }
+
+        scene->data = bytes;
+        scene->batch_count = _u16_get(&bytes[4]);
+        scene->case_count = _u16_get(&bytes[6]);
+        scene->batch = &bytes[HEADER_SIZE];
+        scene->batch_index = 0;
+        scene->batch_case = 0;
+
+        if ((scene->batch_count == 0) || (scene->case_count == 0)) {
+                return false;
+        }
+
+        const uint8_t *batch;
+        uint32_t case_count;
+        uint32_t i;
+
+        batch = scene->batch;
+        case_count = 0;
+
+        for (i = 0; i < scene->batch_count; i++) {
+                if ((batch[0] >= SCENE_TYPE_COUNT) || (batch[1] == 0)) {
+                        return false;
+                }
+
+                case_count += batch[1];
+                batch = _batch_next_get(batch);
+        }
+
+        return (case_count == scene->case_count);
+}
+
+/* Returns the next case, starting over after the last one */
+void
+scene_next(scene_t *scene, scene_case_t *scene_case)
+{
+        const uint8_t * const batch = scene->batch;
+
+        scene_case->type = batch[0];
+        scene_case->pmod = _u16_get(&batch[2]);
+        scene_case->colr = _u16_get(&batch[4]);
+        scene_case->vertices =
+            (const int8_t *)&batch[BATCH_HEADER_SIZE + (scene->batch_case * CASE_SIZE)];
+
+        scene->batch_case++;
+
+        if (scene->batch_case < batch[1]) {
+                return;
+        }
+
+        scene->batch_case = 0;
+        scene->batch_index++;
+
+        if (scene->batch_index == scene->batch_count) {
+                scene->batch_index = 0;
+                scene->batch = &scene->data[HEADER_SIZE];
+        } else {
+                scene->batch = _batch_next_get(batch);
+        }
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2012-2016 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#ifndef SCENE_H_
+#define SCENE_H_
+
+#include <yaul.h>
+
+/* Primitive test scenes, as written by tools/sceneBuilder. A scene is a
+ * list of batches, each of one type, draw mode and color, holding cases of
+ * four vertices relative to the cell the case is drawn in. Lines only use
+ * the first two */
+#define SCENE_TYPE_POLYGON      0
+#define SCENE_TYPE_POLYLINE     1
+#define SCENE_TYPE_LINE         2
+#define SCENE_TYPE_SPRITE       3       /* Distorted, colr is the zoom frame */
+#define SCENE_TYPE_COUNT        4
+
+typedef struct {
+        uint8_t type;
+        uint16_t pmod;
+        uint16_t colr;
+        const int8_t *vertices; /* x0 y0 x1 y1 x2 y2 x3 y3 */
+} scene_case_t;
+
+typedef struct {
+        const uint8_t *data;
+        uint16_t batch_count;
+        uint16_t case_count;
+
+        /* Private */
+        const uint8_t *batch;
+        uint16_t batch_index;
+        uint8_t batch_case;
+} scene_t;
+
+extern bool scene_init(scene_t *scene, const void *data);
+extern void scene_next(scene_t *scene, scene_case_t *scene_case);
+
+#endif /* !SCENE_H_ */
@@ -0,0 +1,7 @@
+#!/bin/bash
+
+# Build data/scenes.txt into assets/SCENES.BIN. The program has to be linked
+# again, but nothing needs to be compiled
+make -s -C ../tools/sceneBuilder
+
+../tools/sceneBuilder/sceneBuilder data/scenes.txt assets/SCENES.BIN
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2012-2016 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#include <yaul.h>
+
+#include "texcache.h"
+
+#define KEY_NONE        (0xFFFFFFFFUL)
+
+typedef struct {
+        uint32_t key;
+        uint32_t used;          /* Use clock of the last hit or upload */
+        uint32_t frame;         /* Frame of the last hit or upload */
+} slot_t;
+
+static slot_t _slots[TEXCACHE_SLOT_COUNT_MAX];
+
+static uint32_t _base;
+static uint32_t _slot_size;
+static uint32_t _slot_count;
+
+static uint32_t _clock;
+static uint32_t _frame;
+
+static texcache_stats_t _stats;
+
+static void _slot_upload(uint32_t, const void *);
+
+/* Returns the number of slots that fit in size bytes. The slot size must be
+ * a multiple of 8 bytes, the character address granularity */
+uint32_t
+texcache_init(uint32_t base, uint32_t size, uint32_t slot_size)
+{
+        uint32_t i;
+
+        _base = base;
+        _slot_size = slot_size;
+        _slot_count = size / slot_size;
+
+        if (_slot_count > TEXCACHE_SLOT_COUNT_MAX) {
+                _slot_count = TEXCACHE_SLOT_COUNT_MAX;
+        }
+
+        for (i = 0; i < _slot_count; i++) {
+                _slots[i].key = KEY_NONE;
+                _slots[i].used = 0;
+                _slots[i].frame = 0;
+        }
+
+        _clock = 0;
+        _frame = 1;
+
+        (void)memset(&_stats, 0x00, sizeof(_stats));
+
+        return _slot_count;
+}
+
+/* Unpins the slots used by the previous frame and clears the statistics.
+ * Must only be called once the VDP1 is done drawing that frame */
+void
+texcache_frame_begin(void)
+{
+        _frame++;
+
+        (void)memset(&_stats, 0x00, sizeof(_stats));
+}
+
+/* Returns the character address of the texture, uploading it on a miss.
+ * Returns 0 when every slot is pinned by the current frame */
+uint32_t
+texcache_get(uint32_t key, const void *texels)
+{
+        uint32_t victim;
+        uint32_t i;
+
+        victim = _slot_count;
+
+        for (i = 0; i < _slot_count; i++) {
+                slot_t * const slot = &_slots[i];
+
+                if (slot->key == key) {
+                        slot->used = ++_clock;
+                        slot->frame = _frame;
+
+                        _stats.hits++;
+
+                        return _base + (i * _slot_size);
+                }
+
+                if (slot->frame == _frame) {
+                        continue;
+                }
+
+                if ((victim == _slot_count) || (slot->used < _slots[victim].used)) {
+                        victim = i;
+                }
+        }
+
+        _stats.misses++;
+
+        if (victim == _slot_count) {
+                _stats.failures++;
+
+                return 0;
+        }
+
+        _slot_upload(victim, texels);
+
+        _slots[victim].key = key;
+        _slots[victim].used = ++_clock;
+        _slots[victim].frame = _frame;
+
+        return _base + (victim * _slot_size);
+}
+
+void
+texcache_stats_get(texcache_stats_t *stats)
+{
+        *stats = _stats;
+}
+
+/* Texels are copied a longword at a time, so they must be 4-byte aligned */
+static void
+_slot_upload(uint32_t slot, const void *texels)
+{
+        volatile uint32_t * const dst =
+            (volatile uint32_t *)(_base + (slot * _slot_size));
+        const uint32_t * const src = texels;
+        uint32_t i;
+
+        for (i = 0; i < (_slot_size / sizeof(uint32_t)); i++) {
+                dst[i] = src[i];
+        }
+
+        _stats.upload_bytes += _slot_size;
+}
@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2012-2016 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#ifndef TEXCACHE_H_
+#define TEXCACHE_H_
+
+#include <yaul.h>
+
+#define TEXCACHE_SLOT_COUNT_MAX (32)
+
+/* A texture cache in VDP1 VRAM. The area is cut into slots of the same
+ * size (a slab), each holding one texture identified by a key. A miss
+ * uploads the texture into the least recently used slot. A slot used
+ * since texcache_frame_begin() is never evicted, as the VDP1 has yet to
+ * read it */
+typedef struct {
+        uint32_t hits;
+        uint32_t misses;
+        uint32_t upload_bytes;
+        uint32_t failures;      /* Every slot was pinned by the frame */
+} texcache_stats_t;
+
+extern uint32_t texcache_init(uint32_t base, uint32_t size,
+    uint32_t slot_size);
+extern void texcache_frame_begin(void);
+extern uint32_t texcache_get(uint32_t key, const void *texels);
+extern void texcache_stats_get(texcache_stats_t *stats);
+
+#endif /* !TEXCACHE_H_ */
@@ -10,48 +10,125 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "harness.h"
+#include "report.h"
+#include "retained.h"
+#include "scene.h"
+#include "texcache.h"
+#include "timer.h"
+
 #define SCREEN_WIDTH    320
 #define SCREEN_HEIGHT   240
 
+#define CPU_FRT_INTERRUPT_PRIORITY_LEVEL 8
+
+/* Frames of ZOOM.TEX, 8 bits per texel */
+#define ZOOM_FRAME_COUNT        (14)
+#define ZOOM_FRAME_WIDTH        (64)
+#define ZOOM_FRAME_HEIGHT       (102)
+#define ZOOM_FRAME_SIZE         (ZOOM_FRAME_WIDTH * ZOOM_FRAME_HEIGHT)
+
+#define ZOOM_PALETTE_COUNT      (256)
+
+#define CRAM_ADDR               (0x25F00000UL)
+
+/* Each sprite shows the animation two frames ahead of the previous one */
+#define SPRITE_COUNT            (6)
+#define SPRITE_FRAME_OFFSET     (2)
+
+/* Fewer slots than frames, so that the cache has to evict */
+#define TEXCACHE_SLOT_COUNT     (8)
+
+#define ANIMATION_PERIOD_MS     (100)
+
+/* Scene cases are drawn one per cell, a page of cells per frame */
+#define SCENE_CELL_SIZE         (16)
+#define SCENE_COLUMN_COUNT      (SCREEN_WIDTH / SCENE_CELL_SIZE)
+#define SCENE_ROW_COUNT         (SCREEN_HEIGHT / SCENE_CELL_SIZE)
+#define SCENE_PAGE_COUNT        (SCENE_COLUMN_COUNT * SCENE_ROW_COUNT)
+
+/* Frames discarded before, and frames kept for, the upload statistics */
+#define TIMING_WARMUP           (1)
+#define TIMING_REPETITIONS      (15)
+
 #define VDP1_CMDT_ORDER_SYSTEM_CLIP_COORDS_INDEX        0
 #define VDP1_CMDT_ORDER_CLEAR_LOCAL_COORDS_INDEX        1
 #define VDP1_CMDT_ORDER_CLEAR_POLYGON_INDEX             2
 #define VDP1_CMDT_ORDER_LOCAL_COORDS_INDEX              3
-#define VDP1_CMDT_ORDER_POLYGON_INDEX                   4
-#define VDP1_CMDT_ORDER_LINE_POINTER_INDEX              (VDP1_CMDT_ORDER_POLYGON_INDEX+8)
-#define VDP1_CMDT_ORDER_DRAW_END_INDEX                  (VDP1_CMDT_ORDER_LINE_POINTER_INDEX+8)
+#define VDP1_CMDT_ORDER_SCENE_INDEX                     4
+#define VDP1_CMDT_ORDER_SPRITE_INDEX                    (VDP1_CMDT_ORDER_SCENE_INDEX+SCENE_PAGE_COUNT)
+#define VDP1_CMDT_ORDER_DRAW_END_INDEX                  (VDP1_CMDT_ORDER_SPRITE_INDEX+SPRITE_COUNT)
 #define VDP1_CMDT_ORDER_COUNT                           (VDP1_CMDT_ORDER_DRAW_END_INDEX+1)
 
-vdp1_cmdt_t* polygons[8];
-vdp1_cmdt_t* lines[8];
+vdp1_cmdt_t* sprites[SPRITE_COUNT];
+
+extern uint8_t asset_zoom_tex[];
+extern uint8_t asset_zoom_pal[];
+extern uint8_t asset_scenes[];
+
+static scene_t _scene;
 
 static vdp1_cmdt_list_t *_cmdt_list = NULL;
 static vdp1_vram_partitions_t _vdp1_vram_partitions;
 
+static retained_list_t _retained_list;
+
+#define STATS_UPLOAD_DIRTY      0
+#define STATS_UPLOAD_FULL       1
+#define STATS_UPLOAD_WORDS      2
+#define STATS_CACHE_BYTES       3
+#define STATS_CACHE_HIT_RATE    4
+#define STATS_COUNT             5
+
+/* Upload time of the dirty words only, of the whole list, the words written
+ * by the former, and the texture cache uploads and hit rate of each frame */
+static harness_t _harnesses[STATS_COUNT];
+
+static volatile uint32_t _animation_step = 0;
+
+/* Frames are timing the full upload */
+static bool _upload_full_pass = false;
+
 static void _init(void);
 
 static void _cmdt_list_init(void);
 
-static void _polygon_pointer_init(void);
-static void _polygon_pointer_config(void);
+static void _scene_init(void);
+static void _scene_page_config(void);
+
+static void _sprite_init(void);
+static void _sprite_config(void);
+
+static void _upload(void);
 
 int
 main(void)
 {
         _init();
 
-        _polygon_pointer_config();
+        texcache_frame_begin();
+        _sprite_config();
+        _scene_page_config();
+
+        retained_list_upload_full(&_retained_list);
 
         while (true) {
 
-                _polygon_pointer_config();
+                /* The sprites go first, so that the scene cannot take
+                 * their cache slots */
+                texcache_frame_begin();
+                _sprite_config();
+                _scene_page_config();
 
-                vdp1_sync_cmdt_list_put(_cmdt_list, 0);
+                _upload();
 
                 vdp1_sync_render();
 
                 vdp1_sync();
+                /* Commits what the records wrote to the console */
+                vdp2_sync();
                 vdp1_sync_wait();
+                vdp2_sync_wait();
 
         }
 
@@ -76,14 +153,156 @@ user_init(void)
 
         vdp1_vram_partitions_get(&_vdp1_vram_partitions);
 
+        /* Records go to the console when no USB dev cart takes them */
+        dbgio_dev_default_init(DBGIO_DEV_VDP2_ASYNC);
+        dbgio_dev_font_load();
+
         vdp2_sync();
         vdp2_sync_wait();
 }
 
+static void
+_animation_timer_handler(struct timer *timer __unused)
+{
+        _animation_step++;
+}
+
 static void
 _init(void)
 {
+        static struct timer animation_timer = {
+                .delay = TIMER_MS(ANIMATION_PERIOD_MS),
+                .period = TIMER_MS(ANIMATION_PERIOD_MS),
+                .callback = _animation_timer_handler
+        };
+
+        timer_init(CPU_FRT_INTERRUPT_PRIORITY_LEVEL);
+
+        (void)texcache_init((uint32_t)_vdp1_vram_partitions.texture_base,
+            TEXCACHE_SLOT_COUNT * ZOOM_FRAME_SIZE, ZOOM_FRAME_SIZE);
+
         _cmdt_list_init();
+
+        retained_list_init(&_retained_list, _cmdt_list, 0);
+
+        report_init("vdp1Drawing");
+        report_pass_begin();
+
+        for (uint32_t i = 0; i < STATS_COUNT; i++) {
+                harness_init(&_harnesses[i], TIMING_WARMUP, TIMING_REPETITIONS);
+        }
+
+        (void)timer_add(&animation_timer);
+}
+
+/* Statistics are reported in hundredths, counts are whole */
+static void
+_stats_count_scale(harness_stats_t *stats)
+{
+        stats->min *= 100;
+        stats->median *= 100;
+        stats->max *= 100;
+        stats->mean *= 100;
+        stats->stddev *= 100;
+}
+
+static void
+_upload_report(const char *variant, harness_t *harness, bool ticks)
+{
+        harness_stats_t stats;
+
+        harness_stats_get(harness, &stats);
+
+        if (!ticks) {
+                _stats_count_scale(&stats);
+
+                report_stats("cmdt upload", variant, "words", &stats);
+
+                return;
+        }
+
+        stats.min = timer_ticks_us100(stats.min);
+        stats.median = timer_ticks_us100(stats.median);
+        stats.max = timer_ticks_us100(stats.max);
+        stats.mean = timer_ticks_us100(stats.mean);
+        stats.stddev = timer_ticks_us100(stats.stddev);
+
+        report_stats("cmdt upload", variant, "us", &stats);
+}
+
+/* Texture bytes uploaded by each frame, and the percentage of frame lookups
+ * that hit, in hundredths */
+static void
+_cache_report(void)
+{
+        harness_stats_t stats;
+
+        harness_stats_get(&_harnesses[STATS_CACHE_BYTES], &stats);
+
+        _stats_count_scale(&stats);
+
+        report_stats("texture cache", "upload", "bytes", &stats);
+
+        harness_stats_get(&_harnesses[STATS_CACHE_HIT_RATE], &stats);
+
+        report_stats("texture cache", "hit rate", "%", &stats);
+}
+
+/* Write the dirty words of the list to VDP1 VRAM. Once every dirty
+ * statistic of a pass is complete, the following frames write the whole
+ * list instead, only to time a full upload against the incremental one.
+ * Both leave the same list in VDP1 VRAM */
+static void
+_upload(void)
+{
+        uint32_t start;
+
+        if (_upload_full_pass) {
+                start = timer_ticks_get();
+                retained_list_upload_full(&_retained_list);
+                const uint32_t full_ticks = timer_ticks_get() - start;
+
+                if (!harness_sample_add(&_harnesses[STATS_UPLOAD_FULL], full_ticks)) {
+                        return;
+                }
+
+                _upload_report("dirty", &_harnesses[STATS_UPLOAD_DIRTY], true);
+                _upload_report("full", &_harnesses[STATS_UPLOAD_FULL], true);
+                _upload_report("dirty", &_harnesses[STATS_UPLOAD_WORDS], false);
+                _cache_report();
+
+                report_pass_begin();
+
+                for (uint32_t i = 0; i < STATS_COUNT; i++) {
+                        harness_init(&_harnesses[i], TIMING_WARMUP, TIMING_REPETITIONS);
+                }
+
+                _upload_full_pass = false;
+
+                return;
+        }
+
+        start = timer_ticks_get();
+        retained_list_upload(&_retained_list);
+        const uint32_t dirty_ticks = timer_ticks_get() - start;
+
+        const uint32_t dirty_words = _retained_list.words;
+
+        texcache_stats_t cache_stats;
+
+        texcache_stats_get(&cache_stats);
+
+        const uint32_t lookups = cache_stats.hits + cache_stats.misses;
+        const uint32_t hit_rate = (lookups == 0) ? 10000 :
+            ((cache_stats.hits * 10000) / lookups);
+
+        (void)harness_sample_add(&_harnesses[STATS_UPLOAD_DIRTY], dirty_ticks);
+        (void)harness_sample_add(&_harnesses[STATS_UPLOAD_WORDS], dirty_words);
+        (void)harness_sample_add(&_harnesses[STATS_CACHE_BYTES], cache_stats.upload_bytes);
+
+        if (harness_sample_add(&_harnesses[STATS_CACHE_HIT_RATE], hit_rate)) {
+                _upload_full_pass = true;
+        }
 }
 
 static void
@@ -120,14 +339,12 @@ _cmdt_list_init(void)
         vdp1_cmdt_t * const cmdts =
             &_cmdt_list->cmdts[0];
 
-        for (int i = 0; i<8; i++) {
-          polygons[i] = &cmdts[VDP1_CMDT_ORDER_POLYGON_INDEX+i];
-        }
-        for (int i = 0; i<8; i++) {
-          lines[i] = &cmdts[VDP1_CMDT_ORDER_LINE_POINTER_INDEX+i];
+        for (int i = 0; i<SPRITE_COUNT; i++) {
+          sprites[i] = &cmdts[VDP1_CMDT_ORDER_SPRITE_INDEX+i];
         }
 
-        _polygon_pointer_init();
+        _scene_init();
+        _sprite_init();
 
         vdp1_cmdt_system_clip_coord_set(&cmdts[VDP1_CMDT_ORDER_SYSTEM_CLIP_COORDS_INDEX]);
         vdp1_cmdt_vtx_system_clip_coord_set(&cmdts[VDP1_CMDT_ORDER_SYSTEM_CLIP_COORDS_INDEX],
@@ -153,221 +370,153 @@ _cmdt_list_init(void)
 
 
 static void
-_polygon_pointer_init(void)
+_scene_init(void)
+{
+        if (!scene_init(&_scene, asset_scenes)) {
+                _scene.case_count = 0;
+        }
+}
+
+/* Each frame draws the next page of cases, one per cell. A sprite whose
+ * frame cannot be cached, or a cell past the last case of a short scene,
+ * is skipped. Every scene command is set again, so all of them are dirty.
+ * Only the words that really changed reach VDP1 VRAM */
+static void
+_scene_page_config(void)
+{
+        const uint32_t count = (_scene.case_count < SCENE_PAGE_COUNT) ?
+            _scene.case_count : SCENE_PAGE_COUNT;
+
+        for (uint32_t i = 0; i < SCENE_PAGE_COUNT; i++) {
+          vdp1_cmdt_t * const cmdt = &_cmdt_list->cmdts[VDP1_CMDT_ORDER_SCENE_INDEX+i];
+
+          retained_cmdt_dirty(&_retained_list, VDP1_CMDT_ORDER_SCENE_INDEX+i);
+
+          if (i >= count) {
+            vdp1_cmdt_jump_skip_next(cmdt);
+            continue;
+          }
+
+          scene_case_t scene_case;
+
+          scene_next(&_scene, &scene_case);
+
+          vdp1_cmdt_draw_mode_t draw_mode;
+
+          draw_mode.raw = scene_case.pmod;
+
+          vdp1_cmdt_jump_clear(cmdt);
+
+          switch (scene_case.type) {
+          case SCENE_TYPE_POLYGON:
+            vdp1_cmdt_polygon_set(cmdt);
+            vdp1_cmdt_color_set(cmdt, scene_case.colr);
+            break;
+          case SCENE_TYPE_POLYLINE:
+            vdp1_cmdt_polyline_set(cmdt);
+            vdp1_cmdt_color_set(cmdt, scene_case.colr);
+            break;
+          case SCENE_TYPE_LINE:
+            vdp1_cmdt_line_set(cmdt);
+            vdp1_cmdt_color_set(cmdt, scene_case.colr);
+            break;
+          case SCENE_TYPE_SPRITE: {
+            const uint32_t frame = scene_case.colr % ZOOM_FRAME_COUNT;
+            const uint32_t char_base = texcache_get(frame,
+                &asset_zoom_tex[frame * ZOOM_FRAME_SIZE]);
+
+            if (char_base == 0) {
+              vdp1_cmdt_jump_skip_next(cmdt);
+            }
+
+            /* ZOOM.TEX is 8 bits per texel, whatever the scene says */
+            draw_mode.color_mode = 4;
+
+            vdp1_cmdt_distorted_sprite_set(cmdt);
+            /* The cell may have held a polygon colour. The palette is in
+             * CRAM bank 0 */
+            vdp1_cmdt_color_set(cmdt, 0);
+            vdp1_cmdt_char_base_set(cmdt, char_base);
+            vdp1_cmdt_char_size_set(cmdt, ZOOM_FRAME_WIDTH, ZOOM_FRAME_HEIGHT);
+          } break;
+          }
+
+          vdp1_cmdt_draw_mode_set(cmdt, draw_mode);
+
+          const int16_t x = (i % SCENE_COLUMN_COUNT) * SCENE_CELL_SIZE;
+          const int16_t y = (i / SCENE_COLUMN_COUNT) * SCENE_CELL_SIZE;
+          int16_vec2_t points[4];
+
+          for (uint32_t v = 0; v < 4; v++) {
+            points[v].x = x + scene_case.vertices[2 * v];
+            points[v].y = y + scene_case.vertices[(2 * v) + 1];
+          }
+
+          vdp1_cmdt_vtx_set(cmdt, points);
+        }
+}
+
+static void
+_sprite_init(void)
 {
         static const vdp1_cmdt_draw_mode_t draw_mode = {
+                .color_mode = 4,
                 .pre_clipping_disable = true
         };
 
-        for (int i=0; i<8; i++) {
-          vdp1_cmdt_polygon_set(polygons[i]);
-          vdp1_cmdt_draw_mode_set(polygons[i], draw_mode);
+        volatile uint16_t * const cram = (volatile uint16_t *)CRAM_ADDR;
+        const uint16_t * const palette = (const uint16_t *)asset_zoom_pal;
+
+        /* Texels are palette codes, looked up in CRAM bank 0 by VDP2 */
+        for (uint32_t i = 0; i < ZOOM_PALETTE_COUNT; i++) {
+                cram[i] = palette[i];
         }
-        for (int i=0; i<8; i++) {
-          vdp1_cmdt_line_set(lines[i]);
-          vdp1_cmdt_draw_mode_set(lines[i], draw_mode);
+
+        for (int i=0; i<SPRITE_COUNT; i++) {
+          vdp1_cmdt_scaled_sprite_set(sprites[i]);
+          vdp1_cmdt_draw_mode_set(sprites[i], draw_mode);
+          vdp1_cmdt_char_size_set(sprites[i], ZOOM_FRAME_WIDTH, ZOOM_FRAME_HEIGHT);
         }
 }
 
+/* Each sprite asks the cache for its current frame. A frame that is not
+ * resident is uploaded over the least recently used one */
 static void
-_polygon_pointer_config(void)
+_sprite_config(void)
 {
-    int16_vec2_t points[4];
-
-    points[0].x = 10;
-    points[1].x = 9;
-    points[2].x = 9;
-    points[3].x = 10;
-    points[0].y = 10;
-    points[1].y = 14;
-    points[2].y = 14;
-    points[3].y = 10;
-
-    vdp1_cmdt_vtx_set(polygons[0], points);
-    vdp1_cmdt_color_set(polygons[0], RGB1555(1,0x1F,0x1F,0x1F));
-
-    points[0].x = 10 + SCREEN_WIDTH/4;
-    points[1].x = 9 + SCREEN_WIDTH/4;
-    points[0].y = 10;
-    points[1].y = 14;
-    vdp1_cmdt_vtx_set(lines[0], points);
-    vdp1_cmdt_color_set(lines[0], RGB1555(1,0x1F,0x1F,0x1F));
-
-    points[0].x = 9;
-    points[1].x = 10;
-    points[2].x = 10;
-    points[3].x = 9;
-    points[0].y = 10 + (SCREEN_HEIGHT/4);
-    points[1].y = 14 + (SCREEN_HEIGHT/4);
-    points[2].y = 14 + (SCREEN_HEIGHT/4);
-    points[3].y = 10 + (SCREEN_HEIGHT/4);
-
-    vdp1_cmdt_vtx_set(polygons[1], points);
-    vdp1_cmdt_color_set(polygons[1], RGB1555(1,0x1F,0x1F,0x1F));
-
-    points[0].x = 9 + SCREEN_WIDTH/4;
-    points[1].x = 10 + SCREEN_WIDTH/4;
-    points[2].x = 10 + SCREEN_WIDTH/4;
-    points[3].x = 9 + SCREEN_WIDTH/4;
-    points[0].y = 10 + (SCREEN_HEIGHT/4);
-    points[1].y = 14 + (SCREEN_HEIGHT/4);
-    points[2].y = 14 + (SCREEN_HEIGHT/4);
-    points[3].y = 10 + (SCREEN_HEIGHT/4);
-
-    vdp1_cmdt_vtx_set(lines[1], points);
-    vdp1_cmdt_color_set(lines[1], RGB1555(1,0x1F,0x1F,0x1F));
-
-    points[0].x = 9;
-    points[1].x = 10;
-    points[2].x = 10;
-    points[3].x = 9;
-    points[0].y = 14 + ((2*SCREEN_HEIGHT)/4);
-    points[1].y = 10 + ((2*SCREEN_HEIGHT)/4);
-    points[2].y = 10 + ((2*SCREEN_HEIGHT)/4);
-    points[3].y = 14 + ((2*SCREEN_HEIGHT)/4);
-
-    vdp1_cmdt_vtx_set(polygons[2], points);
-    vdp1_cmdt_color_set(polygons[2], RGB1555(1,0x1F,0x1F,0x1F));
-
-    points[0].x = 9 + SCREEN_WIDTH/4;
-    points[1].x = 10 + SCREEN_WIDTH/4;
-    points[2].x = 10 + SCREEN_WIDTH/4;
-    points[3].x = 9 + SCREEN_WIDTH/4;
-    points[0].y = 14 + ((2*SCREEN_HEIGHT)/4);
-    points[1].y = 10 + ((2*SCREEN_HEIGHT)/4);
-    points[2].y = 10 + ((2*SCREEN_HEIGHT)/4);
-    points[3].y = 14 + ((2*SCREEN_HEIGHT)/4);
-
-    vdp1_cmdt_vtx_set(lines[2], points);
-    vdp1_cmdt_color_set(lines[2], RGB1555(1,0x1F,0x1F,0x1F));
-
-    points[0].x = 10;
-    points[1].x = 9;
-    points[2].x = 9;
-    points[3].x = 10;
-    points[0].y = 14 + ((3*SCREEN_HEIGHT)/4);
-    points[1].y = 10 + ((3*SCREEN_HEIGHT)/4);
-    points[2].y = 10 + ((3*SCREEN_HEIGHT)/4);
-    points[3].y = 14 + ((3*SCREEN_HEIGHT)/4);
-
-    vdp1_cmdt_vtx_set(polygons[3], points);
-    vdp1_cmdt_color_set(polygons[3], RGB1555(1,0x1F,0x1F,0x1F));
-
-    points[0].x = 10 + SCREEN_WIDTH/4;
-    points[1].x = 9 + SCREEN_WIDTH/4;
-    points[2].x = 9 + SCREEN_WIDTH/4;
-    points[3].x = 10 + SCREEN_WIDTH/4;
-    points[0].y = 14 + ((3*SCREEN_HEIGHT)/4);
-    points[1].y = 10 + ((3*SCREEN_HEIGHT)/4);
-    points[2].y = 10 + ((3*SCREEN_HEIGHT)/4);
-    points[3].y = 14 + ((3*SCREEN_HEIGHT)/4);
-
-    vdp1_cmdt_vtx_set(lines[3], points);
-    vdp1_cmdt_color_set(lines[3], RGB1555(1,0x1F,0x1F,0x1F));
-
-    points[0].x = 10 + SCREEN_WIDTH/2;
-    points[1].x = 14 + SCREEN_WIDTH/2;
-    points[2].x = 14 + SCREEN_WIDTH/2;
-    points[3].x = 10 + SCREEN_WIDTH/2;
-    points[0].y = 10;
-    points[1].y = 9;
-    points[2].y = 9;
-    points[3].y = 10;
-
-    vdp1_cmdt_vtx_set(polygons[4], points);
-    vdp1_cmdt_color_set(polygons[4], RGB1555(1,0x1F,0x1F,0x1F));
-
-    points[0].x = 10 + SCREEN_WIDTH/4 + SCREEN_WIDTH/2;
-    points[1].x = 14 + SCREEN_WIDTH/4 + SCREEN_WIDTH/2;
-    points[2].x = 14 + SCREEN_WIDTH/4 + SCREEN_WIDTH/2;
-    points[3].x = 10 + SCREEN_WIDTH/4 + SCREEN_WIDTH/2;
-    points[0].y = 10;
-    points[1].y = 9;
-    points[2].y = 9;
-    points[3].y = 10;
-
-    vdp1_cmdt_vtx_set(lines[4], points);
-    vdp1_cmdt_color_set(lines[4], RGB1555(1,0x1F,0x1F,0x1F));
-
-    points[0].x = 10 + SCREEN_WIDTH/2;
-    points[1].x = 14 + SCREEN_WIDTH/2;
-    points[2].x = 14 + SCREEN_WIDTH/2;
-    points[3].x = 10 + SCREEN_WIDTH/2;
-    points[0].y = 9 + (SCREEN_HEIGHT/4);
-    points[1].y = 10 + (SCREEN_HEIGHT/4);
-    points[2].y = 10 + (SCREEN_HEIGHT/4);
-    points[3].y = 9 + (SCREEN_HEIGHT/4);
-
-    vdp1_cmdt_vtx_set(polygons[5], points);
-    vdp1_cmdt_color_set(polygons[5], RGB1555(1,0x1F,0x1F,0x1F));
-
-    points[0].x = 10 + SCREEN_WIDTH/4 + SCREEN_WIDTH/2;
-    points[1].x = 14 + SCREEN_WIDTH/4 + SCREEN_WIDTH/2;
-    points[2].x = 14 + SCREEN_WIDTH/4 + SCREEN_WIDTH/2;
-    points[3].x = 10 + SCREEN_WIDTH/4 + SCREEN_WIDTH/2;
-    points[0].y = 9 + (SCREEN_HEIGHT/4);
-    points[1].y = 10 + (SCREEN_HEIGHT/4);
-    points[2].y = 10 + (SCREEN_HEIGHT/4);
-    points[3].y = 9 + (SCREEN_HEIGHT/4);
-
-    vdp1_cmdt_vtx_set(lines[5], points);
-    vdp1_cmdt_color_set(lines[5], RGB1555(1,0x1F,0x1F,0x1F));
-
-    points[0].x = 14 + SCREEN_WIDTH/2;
-    points[1].x = 10 + SCREEN_WIDTH/2;
-    points[2].x = 10 + SCREEN_WIDTH/2;
-    points[3].x = 14 + SCREEN_WIDTH/2;
-    points[0].y = 9 + ((2*SCREEN_HEIGHT)/4);
-    points[1].y = 10 + ((2*SCREEN_HEIGHT)/4);
-    points[2].y = 10 + ((2*SCREEN_HEIGHT)/4);
-    points[3].y = 9 + ((2*SCREEN_HEIGHT)/4);
-
-    vdp1_cmdt_vtx_set(polygons[6], points);
-    vdp1_cmdt_color_set(polygons[6], RGB1555(1,0x1F,0x1F,0x1F));
-
-    points[0].x = 14 + SCREEN_WIDTH/4 + SCREEN_WIDTH/2;
-    points[1].x = 10 + SCREEN_WIDTH/4 + SCREEN_WIDTH/2;
-    points[2].x = 10 + SCREEN_WIDTH/4 + SCREEN_WIDTH/2;
-    points[3].x = 14 + SCREEN_WIDTH/4 + SCREEN_WIDTH/2;
-    points[0].y = 9 + ((2*SCREEN_HEIGHT)/4);
-    points[1].y = 10 + ((2*SCREEN_HEIGHT)/4);
-    points[2].y = 10 + ((2*SCREEN_HEIGHT)/4);
-    points[3].y = 9 + ((2*SCREEN_HEIGHT)/4);
-
-    vdp1_cmdt_vtx_set(lines[6], points);
-    vdp1_cmdt_color_set(lines[6], RGB1555(1,0x1F,0x1F,0x1F));
-
-    points[0].x = 14 + SCREEN_WIDTH/2;
-    points[1].x = 10 + SCREEN_WIDTH/2;
-    points[2].x = 10 + SCREEN_WIDTH/2;
-    points[3].x = 14 + SCREEN_WIDTH/2;
-    points[0].y = 10 + ((3*SCREEN_HEIGHT)/4);
-    points[1].y = 9 + ((3*SCREEN_HEIGHT)/4);
-    points[2].y = 9 + ((3*SCREEN_HEIGHT)/4);
-    points[3].y = 10 + ((3*SCREEN_HEIGHT)/4);
-
-    vdp1_cmdt_vtx_set(polygons[7], points);
-    vdp1_cmdt_color_set(polygons[7], RGB1555(1,0x1F,0x1F,0x1F));
-
-    points[0].x = 14 + SCREEN_WIDTH/4 + SCREEN_WIDTH/2;
-    points[1].x = 10 + SCREEN_WIDTH/4 + SCREEN_WIDTH/2;
-    points[2].x = 10 + SCREEN_WIDTH/4 + SCREEN_WIDTH/2;
-    points[3].x = 14 + SCREEN_WIDTH/4 + SCREEN_WIDTH/2;
-    points[0].y = 10 + ((3*SCREEN_HEIGHT)/4);
-    points[1].y = 9 + ((3*SCREEN_HEIGHT)/4);
-    points[2].y = 9 + ((3*SCREEN_HEIGHT)/4);
-    points[3].y = 10 + ((3*SCREEN_HEIGHT)/4);
-
-    vdp1_cmdt_vtx_set(lines[7], points);
-    vdp1_cmdt_color_set(lines[7], RGB1555(1,0x1F,0x1F,0x1F));
+        const uint32_t step = _animation_step;
+
+        for (int i = 0; i<SPRITE_COUNT; i++) {
+          const uint32_t frame = (step + (i * SPRITE_FRAME_OFFSET)) % ZOOM_FRAME_COUNT;
+          const uint32_t char_base = texcache_get(frame,
+              &asset_zoom_tex[frame * ZOOM_FRAME_SIZE]);
+
+          /* Half, three quarters and full size, over three columns and two
+           * rows */
+          const int16_t width = (ZOOM_FRAME_WIDTH * ((i % 3) + 2)) / 4;
+          const int16_t height = (ZOOM_FRAME_HEIGHT * ((i % 3) + 2)) / 4;
+          const int16_t x = (((2 * (i % 3)) + 1) * SCREEN_WIDTH) / 6;
+          const int16_t y = (((2 * (i / 3)) + 1) * SCREEN_HEIGHT) / 4;
+
+          if (char_base == 0) {
+            vdp1_cmdt_jump_skip_next(sprites[i]);
+          } else {
+            vdp1_cmdt_jump_clear(sprites[i]);
+            vdp1_cmdt_char_base_set(sprites[i], char_base);
+          }
+
+          /* Without a zoom point, a scaled sprite spans from vertex A to
+           * vertex C */
+          sprites[i]->cmd_xa = x - (width / 2);
+          sprites[i]->cmd_ya = y - (height / 2);
+          sprites[i]->cmd_xc = x + (width / 2) - 1;
+          sprites[i]->cmd_yc = y + (height / 2) - 1;
+
+          retained_cmdt_dirty(&_retained_list, VDP1_CMDT_ORDER_SPRITE_INDEX+i);
+        }
 }
 
 static void
 _vblank_out_handler(void *work __unused)
 {
 }
-
-static void
-_cpu_frt_ovi_handler(void)
-{
-}
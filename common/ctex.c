@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#include <yaul.h>
+
+#include "ctex.h"
+
+bool
+ctex_valid(const void *ctex)
+{
+        const ctex_header_t * const header = ctex;
+
+        return (header->magic == CTEX_MAGIC);
+}
+
+uint32_t
+ctex_frame_compressed_size_get(const void *ctex, uint32_t frame)
+{
+        const ctex_header_t * const header = ctex;
+
+        return header->offsets[frame + 1] - header->offsets[frame];
+}
+
+/* Decodes a frame into dst, which has to be work RAM. Copies read back
+ * what was already decoded, which from VDP1 VRAM would be a B-bus read per
+ * byte. The frame is then moved to VDP1 VRAM in longwords, or by DMA */
+void
+ctex_frame_decode(const void *ctex, uint32_t frame, void *dst)
+{
+        const ctex_header_t * const header = ctex;
+
+        const uint8_t *src = (const uint8_t *)ctex + header->offsets[frame];
+        const uint8_t * const end = (const uint8_t *)ctex + header->offsets[frame + 1];
+
+        uint8_t *d = dst;
+
+        while (src < end) {
+                const uint32_t token = *src++;
+
+                if (token < 0x80) {
+                        uint32_t length = token + 1;
+
+                        do {
+                                *d++ = *src++;
+                        } while (--length != 0);
+                } else if (token < 0xC0) {
+                        const uint8_t value = *src++;
+                        uint32_t length = (token & 0x3F) + CTEX_RUN_MIN;
+
+                        do {
+                                *d++ = value;
+                        } while (--length != 0);
+                } else {
+                        const uint32_t distance = (src[0] << 8) | src[1];
+                        const uint8_t *s = d - distance;
+                        uint32_t length = (token & 0x3F) + CTEX_RUN_MIN;
+
+                        src += 2;
+
+                        do {
+                                *d++ = *s++;
+                        } while (--length != 0);
+                }
+        }
+}
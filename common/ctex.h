@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#ifndef CTEX_H_
+#define CTEX_H_
+
+#include <yaul.h>
+
+/* Compressed textures, as written by tools/assetConverter -c. All fields
+ * are big endian:
+ *
+ *   'C' 'T' 'X' '1'
+ *   frame count
+ *   frame size, in bytes once decoded
+ *   offsets[frame count + 1], of each frame from the start of the file
+ *
+ * Frames are compressed on their own, so any of them can be decoded
+ * alone. The file must be 4-byte aligned. A frame is a sequence of byte
+ * aligned tokens:
+ *
+ *   0x00..0x7F  Copy the next 1..128 bytes
+ *   0x80..0xBF  Repeat the next byte 3..66 times
+ *   0xC0..0xFF  Copy 3..66 bytes already decoded, a 16-bit distance back */
+
+#define CTEX_MAGIC              (0x43545831UL)
+
+#define CTEX_LITERAL_MAX        (128)
+#define CTEX_RUN_MIN            (3)
+#define CTEX_RUN_MAX            (66)
+#define CTEX_DISTANCE_MAX       (65535)
+
+typedef struct {
+        uint32_t magic;
+        uint32_t frame_count;
+        uint32_t frame_size;
+        uint32_t offsets[];
+} ctex_header_t;
+
+extern bool ctex_valid(const void *ctex);
+extern uint32_t ctex_frame_compressed_size_get(const void *ctex, uint32_t frame);
+extern void ctex_frame_decode(const void *ctex, uint32_t frame, void *dst);
+
+#endif /* !CTEX_H_ */
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#include <yaul.h>
+
+#include "harness.h"
+
+static void _samples_sort(uint32_t *, uint32_t);
+static uint32_t _sqrt(uint64_t);
+
+void
+harness_init(harness_t *harness, uint32_t warmup, uint32_t repetitions)
+{
+        if (repetitions > HARNESS_SAMPLES_MAX) {
+                repetitions = HARNESS_SAMPLES_MAX;
+        }
+
+        if (repetitions == 0) {
+                repetitions = 1;
+        }
+
+        harness->warmup = warmup;
+        harness->repetitions = repetitions;
+        harness->seen = 0;
+        harness->count = 0;
+}
+
+/* Returns true once every repetition has been collected */
+bool
+harness_sample_add(harness_t *harness, uint32_t sample)
+{
+        if (harness->count >= harness->repetitions) {
+                return true;
+        }
+
+        harness->seen++;
+
+        if (harness->seen > harness->warmup) {
+                harness->samples[harness->count] = sample;
+                harness->count++;
+        }
+
+        return (harness->count >= harness->repetitions);
+}
+
+/* Sorts the samples, rejects the ones outside 1.5 interquartile ranges of
+ * the quartiles, then computes the statistics of the samples kept */
+void
+harness_stats_get(harness_t *harness, harness_stats_t *stats)
+{
+        (void)memset(stats, 0x00, sizeof(harness_stats_t));
+
+        if (harness->count == 0) {
+                return;
+        }
+
+        uint32_t * const samples = harness->samples;
+
+        _samples_sort(samples, harness->count);
+
+        uint32_t first = 0;
+        uint32_t last = harness->count;
+
+        /* Too few samples for the quartiles to mean anything */
+        if (harness->count >= 4) {
+                const uint32_t q1 = samples[harness->count / 4];
+                const uint32_t q3 = samples[(3 * harness->count) / 4];
+                const uint32_t fence = ((q3 - q1) * 3) / 2;
+
+                const uint32_t low = (q1 > fence) ? (q1 - fence) : 0;
+                const uint32_t high = q3 + fence;
+
+                while ((first < last) && (samples[first] < low)) {
+                        first++;
+                }
+
+                while ((last > first) && (samples[last - 1] > high)) {
+                        last--;
+                }
+        }
+
+        const uint32_t count = last - first;
+
+        uint64_t sum = 0;
+        uint32_t i;
+
+        for (i = first; i < last; i++) {
+                sum += samples[i];
+        }
+
+        const uint32_t mean = (uint32_t)(sum / count);
+
+        uint64_t variance = 0;
+
+        for (i = first; i < last; i++) {
+                const int32_t diff = (int32_t)(samples[i] - mean);
+
+                variance += (uint64_t)((int64_t)diff * diff);
+        }
+
+        variance /= count;
+
+        stats->min = samples[first];
+        stats->max = samples[last - 1];
+        stats->median = ((count & 1) != 0) ?
+            samples[first + (count / 2)] :
+            (uint32_t)(((uint64_t)samples[first + (count / 2) - 1] +
+                samples[first + (count / 2)]) / 2);
+        stats->mean = mean;
+        stats->stddev = _sqrt(variance);
+        stats->count = count;
+        stats->rejected = harness->count - count;
+}
+
+/* Insertion sort, there are never more than HARNESS_SAMPLES_MAX samples */
+static void
+_samples_sort(uint32_t *samples, uint32_t count)
+{
+        uint32_t i;
+
+        for (i = 1; i < count; i++) {
+                const uint32_t sample = samples[i];
+
+                uint32_t j;
+                for (j = i; (j > 0) && (samples[j - 1] > sample); j--) {
+                        samples[j] = samples[j - 1];
+                }
+
+                samples[j] = sample;
+        }
+}
+
+static uint32_t
+_sqrt(uint64_t value)
+{
+        uint64_t root = 0;
+        uint64_t bit = 1ULL << 62;
+
+        while (bit > value) {
+                bit >>= 2;
+        }
+
+        while (bit != 0) {
+                if (value >= (root + bit)) {
+                        value -= root + bit;
+                        root = (root >> 1) + bit;
+                } else {
+                        root >>= 1;
+                }
+
+                bit >>= 2;
+        }
+
+        return (uint32_t)root;
+}
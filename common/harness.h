@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#ifndef HARNESS_H_
+#define HARNESS_H_
+
+#include <yaul.h>
+
+#define HARNESS_SAMPLES_MAX     32
+
+typedef struct {
+        uint32_t min;
+        uint32_t median;
+        uint32_t max;
+        uint32_t mean;
+        uint32_t stddev;
+        uint32_t count;         /* Samples kept */
+        uint32_t rejected;      /* Samples rejected as outliers */
+} harness_stats_t;
+
+typedef struct {
+        uint32_t warmup;        /* Samples discarded before collecting */
+        uint32_t repetitions;   /* Samples collected */
+        uint32_t seen;
+        uint32_t count;
+        uint32_t samples[HARNESS_SAMPLES_MAX];
+} harness_t;
+
+extern void harness_init(harness_t *harness, uint32_t warmup,
+    uint32_t repetitions);
+extern bool harness_sample_add(harness_t *harness, uint32_t sample);
+extern void harness_stats_get(harness_t *harness, harness_stats_t *stats);
+
+#endif /* !HARNESS_H_ */
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#include <yaul.h>
+
+#include <stdio.h>
+
+#include "report.h"
+
+#define REPORT_LINE_SIZE        (160)
+
+#if REPORT_SINK_HAS_USB_CART
+/* FIFO and flags of the FT245 on the USB dev cart. TXE is low when the FIFO
+ * can take a byte */
+#define USB_CART_FIFO           (*(volatile uint8_t *)0x22100001UL)
+#define USB_CART_FLAGS          (*(volatile uint8_t *)0x22200001UL)
+#define USB_CART_FLAGS_TXE      (0x02)
+
+/* Polls of the flags before the cart is taken as missing, well over the
+ * time the host takes to drain the FIFO */
+#define USB_CART_POLL_COUNT_MAX (0x100000)
+
+static bool _usb_cart_present = true;
+
+static bool _usb_cart_ready_wait(void);
+#endif /* REPORT_SINK_HAS_USB_CART */
+
+static const char *_program = "";
+static uint32_t _pass = 0;
+
+static char _line[REPORT_LINE_SIZE];
+
+static void _line_write(const char *);
+static void _value_format(char *, size_t, uint32_t);
+
+void
+report_init(const char *program)
+{
+        _program = program;
+        _pass = 0;
+
+#if REPORT_SINK_HAS_USB_CART
+        /* Without a cart, or a host reading it, the wait happens once, here
+         * rather than in the middle of a measurement */
+        _usb_cart_present = _usb_cart_ready_wait();
+#endif /* REPORT_SINK_HAS_USB_CART */
+}
+
+void
+report_pass_begin(void)
+{
+        _pass++;
+
+        (void)snprintf(_line, sizeof(_line), "H,%s,%lu\n", _program, _pass);
+
+        _line_write(_line);
+}
+
+/* The statistics are in hundredths of unit */
+void
+report_stats(const char *name, const char *variant, const char *unit,
+    const harness_stats_t *stats)
+{
+        char min[16];
+        char median[16];
+        char max[16];
+        char stddev[16];
+
+        _value_format(min, sizeof(min), stats->min);
+        _value_format(median, sizeof(median), stats->median);
+        _value_format(max, sizeof(max), stats->max);
+        _value_format(stddev, sizeof(stddev), stats->stddev);
+
+        (void)snprintf(_line, sizeof(_line),
+            "R,%s,%lu,%s,%s,%s,%lu,%lu,%s,%s,%s,%s\n",
+            _program, _pass, name, variant, unit,
+            stats->count, stats->rejected,
+            min, median, max, stddev);
+
+        _line_write(_line);
+}
+
+/* Start and duration are in hundredths of microsecond */
+void
+report_timeline(const char *name, const char *variant, uint32_t index,
+    uint32_t start, uint32_t duration)
+{
+        char start_us[16];
+        char duration_us[16];
+
+        _value_format(start_us, sizeof(start_us), start);
+        _value_format(duration_us, sizeof(duration_us), duration);
+
+        (void)snprintf(_line, sizeof(_line),
+            "T,%s,%lu,%s,%s,%lu,%s,%s\n",
+            _program, _pass, name, variant, index, start_us, duration_us);
+
+        _line_write(_line);
+}
+
+static void
+_value_format(char *buffer, size_t size, uint32_t value100)
+{
+        (void)snprintf(buffer, size, "%lu.%02lu", value100 / 100, value100 % 100);
+}
+
+#if REPORT_SINK_HAS_USB_CART
+/* Returns false when the FIFO stays full. A missing cart must not hang the
+ * program */
+static bool
+_usb_cart_ready_wait(void)
+{
+        uint32_t polls;
+
+        for (polls = 0; (USB_CART_FLAGS & USB_CART_FLAGS_TXE) != 0; polls++) {
+                if (polls == USB_CART_POLL_COUNT_MAX) {
+                        return false;
+                }
+        }
+
+        return true;
+}
+
+/* Gives up on the cart for good when it stops taking bytes */
+static bool
+_usb_cart_line_send(const char *line)
+{
+        const char *c;
+
+        for (c = line; *c != '\0'; c++) {
+                if (!_usb_cart_ready_wait()) {
+                        _usb_cart_present = false;
+
+                        return false;
+                }
+
+                USB_CART_FIFO = *c;
+        }
+
+        return true;
+}
+#endif /* REPORT_SINK_HAS_USB_CART */
+
+static void
+_line_write(const char *line)
+{
+#if REPORT_SINK_HAS_USB_CART
+        if (_usb_cart_present && _usb_cart_line_send(line)) {
+                return;
+        }
+#endif /* REPORT_SINK_HAS_USB_CART */
+
+#if REPORT_SINK_HAS_DBGIO
+        dbgio_puts(line);
+        dbgio_flush();
+#else
+        (void)line;
+#endif /* REPORT_SINK_HAS_DBGIO */
+}
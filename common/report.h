@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#ifndef REPORT_H_
+#define REPORT_H_
+
+#include <yaul.h>
+
+#include "harness.h"
+
+/* Where records are written. By default, to the USB dev cart when it takes
+ * bytes, so that tools/resultCollector can capture them on the host, and
+ * to the current dbgio device otherwise. The cart is only waited on for a
+ * bounded time, then given up on for good. Another sink is picked with,
+ * for instance, SH_CFLAGS+= -DREPORT_SINK=REPORT_SINK_DBGIO */
+#define REPORT_SINK_NONE        0
+#define REPORT_SINK_DBGIO       1 /* Current dbgio device */
+#define REPORT_SINK_USB_CART    2
+#define REPORT_SINK_AUTO        3 /* USB dev cart, or dbgio without one */
+
+#ifndef REPORT_SINK
+#define REPORT_SINK REPORT_SINK_AUTO
+#endif /* !REPORT_SINK */
+
+#define REPORT_SINK_HAS_USB_CART                                               \
+        ((REPORT_SINK == REPORT_SINK_USB_CART) || (REPORT_SINK == REPORT_SINK_AUTO))
+#define REPORT_SINK_HAS_DBGIO                                                  \
+        ((REPORT_SINK == REPORT_SINK_DBGIO) || (REPORT_SINK == REPORT_SINK_AUTO))
+
+/* Records are CSV lines:
+ *
+ *   H,<program>,<pass>
+ *   R,<program>,<pass>,<name>,<variant>,<unit>,<n>,<rejected>,<min>,<median>,<max>,<stddev>
+ *   T,<program>,<pass>,<name>,<variant>,<index>,<start>,<duration>
+ *
+ * H starts a pass over every test of a program. Statistics are printed with
+ * two decimals in <unit>. T is one step of a timeline, in microseconds */
+
+extern void report_init(const char *program);
+extern void report_pass_begin(void);
+extern void report_stats(const char *name, const char *variant,
+    const char *unit, const harness_stats_t *stats);
+extern void report_timeline(const char *name, const char *variant,
+    uint32_t index, uint32_t start, uint32_t duration);
+
+#endif /* !REPORT_H_ */
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#include <yaul.h>
+
+#include "scudma.h"
+
+void
+scudma_config_set(scu_dma_handle_t *handle, const scu_dma_level_cfg_t *cfg)
+{
+        scu_dma_config_buffer(handle, cfg);
+        scu_dma_config_set(SCUDMA_LEVEL, SCU_DMA_START_FACTOR_ENABLE, handle,
+            NULL);
+}
+
+/* One block of len bytes, both addresses incremented */
+void
+scudma_direct_config_set(scu_dma_handle_t *handle, uint32_t dst,
+    const void *src, uint32_t len)
+{
+        const scu_dma_level_cfg_t cfg = {
+                .mode = SCU_DMA_MODE_DIRECT,
+                .xfer.direct.len = len,
+                .xfer.direct.dst = dst,
+                .xfer.direct.src = (uint32_t)src,
+                .stride = SCU_DMA_STRIDE_2_BYTES,
+                .update = SCU_DMA_UPDATE_NONE
+        };
+
+        scudma_config_set(handle, &cfg);
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#ifndef SCUDMA_H_
+#define SCUDMA_H_
+
+#include <yaul.h>
+
+/* Level 0 is the only SCU DMA level that can move more than 4 KB, so every
+ * transfer of the benchmarks runs on it */
+#define SCUDMA_LEVEL            0
+
+/* SCU DMA status register, level 0 in operation */
+#define SCUDMA_DSTA             (0x25FE007C)
+#define SCUDMA_DSTA_D0MV        (1 << 4)
+
+/* A configured level is not updated by a transfer, so scudma_start() can
+ * run the same transfer again */
+extern void scudma_config_set(scu_dma_handle_t *handle,
+    const scu_dma_level_cfg_t *cfg);
+extern void scudma_direct_config_set(scu_dma_handle_t *handle, uint32_t dst,
+    const void *src, uint32_t len);
+
+static inline void
+scudma_start(void)
+{
+        scu_dma_level_fast_start(SCUDMA_LEVEL);
+}
+
+/* Polled by the overlap tests between chunks of work, so it is kept to one
+ * register read */
+static inline bool
+scudma_busy(void)
+{
+        return ((*(volatile uint32_t *)SCUDMA_DSTA & SCUDMA_DSTA_D0MV) != 0);
+}
+
+static inline void
+scudma_wait(void)
+{
+        while (scudma_busy()) {
+        }
+}
+
+#endif /* !SCUDMA_H_ */
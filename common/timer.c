@@ -0,0 +1,411 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#include <yaul.h>
+
+#include "timer.h"
+
+/* Timer slots are heap indices plus one */
+#define TIMER_SLOT_IDLE         (0)
+#define TIMER_SLOT_RUNNING      (-1)
+
+/* A compare match closer than this to the counter might be missed */
+#define TIMER_ARM_MARGIN        (16)
+
+#if TIMER_CLOCK_DIV == 8
+#define TIMER_CLOCK_DIV_SELECT  CPU_FRT_CLOCK_DIV_8
+#elif TIMER_CLOCK_DIV == 32
+#define TIMER_CLOCK_DIV_SELECT  CPU_FRT_CLOCK_DIV_32
+#else
+#define TIMER_CLOCK_DIV_SELECT  CPU_FRT_CLOCK_DIV_128
+#endif
+
+/* FRT registers. cpu_frt_oca_set() also sets CCLRA, which clears the
+ * counter on every compare match A, so the compare match is armed here
+ * instead */
+#define CPU_TIER                (0xFFFFFE10)
+#define CPU_TIER_OCIAE          (1 << 3)
+#define CPU_FTCSR               (0xFFFFFE11)
+#define CPU_FTCSR_OCFA          (1 << 3)
+#define CPU_FTCSR_OVF           (1 << 1)        /* Set until the overflow interrupt is taken */
+#define CPU_FTCSR_CCLRA         (1 << 0)
+#define CPU_OCRAH               (0xFFFFFE14)
+#define CPU_OCRAL               (0xFFFFFE15)
+#define CPU_TOCR                (0xFFFFFE17)
+#define CPU_TOCR_OCRS           (1 << 4)
+
+/* The CPU clock follows the dot clock of the display */
+#define VDP2_TVMD               (0x25F80000)
+#define VDP2_TVMD_HRESO_352     (1 << 0)
+#define VDP2_TVSTAT             (0x25F80004)
+#define VDP2_TVSTAT_PAL         (1 << 0)
+
+/* CPU clock in Hz, by standard then by 320 or 352 dot wide modes */
+static const uint32_t _cpu_clocks[2][2] = {
+        { 26846591, 28636364 },
+        { 26660714, 28437500 }
+};
+
+/* Min-heap of the pending timers, earliest deadline first. Only the root
+ * is ever compared against the counter, so the interrupt costs the same
+ * however many timers are pending */
+static struct timer *_heap[TIMER_COUNT_MAX];
+static uint32_t _heap_count = 0;
+
+static volatile uint32_t _frt_ovf_count = 0;
+
+static uint64_t _phase_stamps[TIMER_PHASE_COUNT];
+
+static void _frt_ovi_handler(void);
+static void _frt_oca_handler(void);
+
+static void _dispatch(void);
+
+static void _oca_arm(uint16_t match);
+static void _oca_disarm(void);
+
+static inline bool
+_deadline_before(uint32_t a, uint32_t b)
+{
+        return ((int32_t)(a - b) < 0);
+}
+
+static inline void
+_heap_set(uint32_t i, struct timer *timer)
+{
+        _heap[i] = timer;
+        timer->slot = i + 1;
+}
+
+static void
+_heap_up(uint32_t i)
+{
+        struct timer * const timer = _heap[i];
+
+        while (i > 0) {
+                const uint32_t parent = (i - 1) >> 1;
+
+                if (!_deadline_before(timer->deadline, _heap[parent]->deadline)) {
+                        break;
+                }
+
+                _heap_set(i, _heap[parent]);
+
+                i = parent;
+        }
+
+        _heap_set(i, timer);
+}
+
+static void
+_heap_down(uint32_t i)
+{
+        struct timer * const timer = _heap[i];
+
+        while (true) {
+                uint32_t child = (i << 1) + 1;
+
+                if (child >= _heap_count) {
+                        break;
+                }
+
+                if (((child + 1) < _heap_count) &&
+                    _deadline_before(_heap[child + 1]->deadline, _heap[child]->deadline)) {
+                        child++;
+                }
+
+                if (!_deadline_before(_heap[child]->deadline, timer->deadline)) {
+                        break;
+                }
+
+                _heap_set(i, _heap[child]);
+
+                i = child;
+        }
+
+        _heap_set(i, timer);
+}
+
+static void
+_heap_insert(struct timer *timer)
+{
+        _heap[_heap_count] = timer;
+        _heap_count++;
+
+        _heap_up(_heap_count - 1);
+}
+
+static void
+_heap_delete(uint32_t i)
+{
+        _heap_count--;
+
+        if (i != _heap_count) {
+                _heap[i] = _heap[_heap_count];
+
+                _heap_up(i);
+                _heap_down(_heap[i]->slot - 1);
+        }
+}
+
+void
+timer_init(uint8_t priority)
+{
+        _heap_count = 0;
+        _frt_ovf_count = 0;
+
+        (void)memset(_phase_stamps, 0x00, sizeof(_phase_stamps));
+
+        cpu_frt_init(TIMER_CLOCK_DIV_SELECT);
+        cpu_frt_ovi_set(_frt_ovi_handler);
+        cpu_frt_interrupt_priority_set(priority);
+
+        /* Only to install the handler. The counter is reset right after,
+         * so a clear by CCLRA in between does not matter */
+        cpu_frt_oca_set(0xFFFF, _frt_oca_handler);
+        _oca_disarm();
+
+        cpu_frt_count_set(0);
+}
+
+/* FRT ticks extended by the overflow count. With interrupts masked, as in
+ * timer_add() or the handlers, the counter can wrap before the overflow
+ * interrupt counts it. The overflow flag is then still set, and a small
+ * count is past that wrap */
+uint64_t
+timer_stamp_get(void)
+{
+        uint32_t ovf_count;
+        uint32_t count;
+        uint8_t ftcsr;
+
+        /* Read again if the overflow interrupt ran between the reads */
+        do {
+                ovf_count = _frt_ovf_count;
+                count = cpu_frt_count_get();
+                ftcsr = *(volatile uint8_t *)CPU_FTCSR;
+        } while (ovf_count != _frt_ovf_count);
+
+        /* A small count was read after the pending wrap, a large one before */
+        if (((ftcsr & CPU_FTCSR_OVF) != 0) && (count < 0x8000)) {
+                ovf_count++;
+        }
+
+        return ((uint64_t)ovf_count << 16) | count;
+}
+
+uint32_t
+timer_ticks_get(void)
+{
+        return (uint32_t)timer_stamp_get();
+}
+
+/* Nanoseconds in ticks, rounded down, for the current video mode. The
+ * remainder is scaled apart so that nothing overflows */
+uint64_t
+timer_ticks_ns(uint64_t ticks)
+{
+        const uint32_t pal =
+            ((*(volatile uint16_t *)VDP2_TVSTAT & VDP2_TVSTAT_PAL) != 0) ? 1 : 0;
+        const uint32_t hreso_352 =
+            ((*(volatile uint16_t *)VDP2_TVMD & VDP2_TVMD_HRESO_352) != 0) ? 1 : 0;
+
+        const uint64_t clock = _cpu_clocks[pal][hreso_352];
+        const uint64_t cycles = ticks * TIMER_CLOCK_DIV;
+
+        return ((cycles / clock) * 1000000000ULL) +
+            (((cycles % clock) * 1000000000ULL) / clock);
+}
+
+/* Hundredths of microseconds, saturated */
+uint32_t
+timer_ticks_us100(uint64_t ticks)
+{
+        const uint64_t us100 = timer_ticks_ns(ticks) / 10;
+
+        return (us100 > UINT32_MAX) ? UINT32_MAX : (uint32_t)us100;
+}
+
+void
+timer_phase_mark(uint32_t phase)
+{
+        _phase_stamps[phase] = timer_stamp_get();
+}
+
+uint64_t
+timer_phase_stamp_get(uint32_t phase)
+{
+        return _phase_stamps[phase];
+}
+
+/* Ticks from one phase to the next, zero if they were marked in the other
+ * order, saturated */
+uint32_t
+timer_phase_ticks_get(uint32_t from, uint32_t to)
+{
+        if (_phase_stamps[to] < _phase_stamps[from]) {
+                return 0;
+        }
+
+        const uint64_t ticks = _phase_stamps[to] - _phase_stamps[from];
+
+        return (ticks > UINT32_MAX) ? UINT32_MAX : (uint32_t)ticks;
+}
+
+int32_t
+timer_add(struct timer *timer)
+{
+        int32_t ret = -1;
+
+        const uint32_t i_mask = cpu_intc_mask_get();
+
+        cpu_intc_mask_set(15);
+
+        if ((timer->callback != NULL) && (timer->slot <= TIMER_SLOT_IDLE) &&
+            (_heap_count < TIMER_COUNT_MAX)) {
+                timer->deadline = timer_ticks_get() + timer->delay;
+
+                _heap_insert(timer);
+                _dispatch();
+
+                ret = 0;
+        }
+
+        cpu_intc_mask_set(i_mask);
+
+        return ret;
+}
+
+int32_t
+timer_remove(struct timer *timer)
+{
+        int32_t ret = -1;
+
+        const uint32_t i_mask = cpu_intc_mask_get();
+
+        cpu_intc_mask_set(15);
+
+        if (timer->slot == TIMER_SLOT_RUNNING) {
+                /* Called from its own callback, it is not requeued */
+                timer->slot = TIMER_SLOT_IDLE;
+
+                ret = 0;
+        } else if (timer->slot > TIMER_SLOT_IDLE) {
+                _heap_delete(timer->slot - 1);
+
+                timer->slot = TIMER_SLOT_IDLE;
+
+                _dispatch();
+
+                ret = 0;
+        }
+
+        cpu_intc_mask_set(i_mask);
+
+        return ret;
+}
+
+/* Runs every expired timer then arms the compare match for the next one.
+ * Called with interrupts masked */
+static void
+_dispatch(void)
+{
+        while (_heap_count > 0) {
+                struct timer * const timer = _heap[0];
+
+                const uint32_t now = timer_ticks_get();
+
+                if (!_deadline_before(now, timer->deadline)) {
+                        _heap_delete(0);
+
+                        timer->slot = TIMER_SLOT_RUNNING;
+
+                        timer->callback(timer);
+
+                        /* Unless the callback removed or added it again */
+                        if (timer->slot == TIMER_SLOT_RUNNING) {
+                                timer->slot = TIMER_SLOT_IDLE;
+
+                                if (timer->period != 0) {
+                                        timer->deadline += timer->period;
+
+                                        _heap_insert(timer);
+                                }
+                        }
+
+                        continue;
+                }
+
+                /* Deadlines past the next overflow are armed again by the
+                 * overflow handler */
+                if ((timer->deadline - now) >= (0x10000 - TIMER_ARM_MARGIN)) {
+                        break;
+                }
+
+                /* Too close to be armed safely, so it runs slightly late */
+                const uint32_t match = ((timer->deadline - now) < TIMER_ARM_MARGIN) ?
+                    (now + TIMER_ARM_MARGIN) : timer->deadline;
+
+                _oca_arm((uint16_t)match);
+
+                return;
+        }
+
+        /* Nothing due before the next overflow */
+        _oca_disarm();
+}
+
+/* Stamps are built from the counter, so it must run free: CCLRA stays
+ * clear */
+static void
+_oca_arm(uint16_t match)
+{
+        volatile uint8_t * const tier = (volatile uint8_t *)CPU_TIER;
+        volatile uint8_t * const ftcsr = (volatile uint8_t *)CPU_FTCSR;
+        volatile uint8_t * const tocr = (volatile uint8_t *)CPU_TOCR;
+
+        *tier &= ~CPU_TIER_OCIAE;
+        *ftcsr &= ~(CPU_FTCSR_OCFA | CPU_FTCSR_CCLRA);
+
+        /* Upper byte first, it is latched until the lower one is written */
+        *tocr &= ~CPU_TOCR_OCRS;
+        *(volatile uint8_t *)CPU_OCRAH = match >> 8;
+        *(volatile uint8_t *)CPU_OCRAL = match & 0xFF;
+
+        *tier |= CPU_TIER_OCIAE;
+}
+
+static void
+_oca_disarm(void)
+{
+        volatile uint8_t * const tier = (volatile uint8_t *)CPU_TIER;
+        volatile uint8_t * const ftcsr = (volatile uint8_t *)CPU_FTCSR;
+
+        *tier &= ~CPU_TIER_OCIAE;
+        *ftcsr &= ~(CPU_FTCSR_OCFA | CPU_FTCSR_CCLRA);
+}
+
+static void
+_frt_ovi_handler(void)
+{
+        volatile uint8_t * const ftcsr = (volatile uint8_t *)CPU_FTCSR;
+
+        /* Counted, so no longer pending for timer_stamp_get() */
+        *ftcsr &= ~CPU_FTCSR_OVF;
+
+        _frt_ovf_count++;
+
+        if (_heap_count > 0) {
+                _dispatch();
+        }
+}
+
+static void
+_frt_oca_handler(void)
+{
+        _dispatch();
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#ifndef TIMER_H_
+#define TIMER_H_
+
+#include <yaul.h>
+
+#define TIMER_COUNT_MAX         16
+
+/* The FRT runs free at the CPU clock divided by 8, 32 or 128 */
+#ifndef TIMER_CLOCK_DIV
+#define TIMER_CLOCK_DIV 8
+#endif /* !TIMER_CLOCK_DIV */
+
+/* Close enough to schedule timers. Measurements are converted with
+ * timer_ticks_ns(), which knows the actual CPU clock */
+#if TIMER_CLOCK_DIV == 8
+#define TIMER_TICKS_1MS         (CPU_FRT_PAL_320_8_COUNT_1MS)
+#elif TIMER_CLOCK_DIV == 32
+#define TIMER_TICKS_1MS         (CPU_FRT_PAL_320_32_COUNT_1MS)
+#elif TIMER_CLOCK_DIV == 128
+#define TIMER_TICKS_1MS         (CPU_FRT_PAL_320_128_COUNT_1MS)
+#else
+#error "TIMER_CLOCK_DIV must be 8, 32 or 128"
+#endif
+
+#define TIMER_MS(ms)            ((uint32_t)(ms) * TIMER_TICKS_1MS)
+
+/* Points of a frame that can be stamped. Stamps count the counter wraps,
+ * so they only ever grow as long as nothing else clears the counter */
+#define TIMER_PHASE_LIST_PUT    0
+#define TIMER_PHASE_DRAW_START  1
+#define TIMER_PHASE_DRAW_END    2
+#define TIMER_PHASE_VBLANK      3
+#define TIMER_PHASE_COUNT       4
+
+struct timer;
+
+typedef void (*timer_callback_t)(struct timer *);
+
+struct timer {
+        uint32_t delay;         /* Ticks before the first expiry */
+        uint32_t period;        /* Ticks between expiries, 0 for a one-shot */
+        timer_callback_t callback;
+        void *work;
+
+        /* Private, zero when the timer is idle */
+        uint32_t deadline;
+        int32_t slot;
+};
+
+/* Callbacks run in the FRT interrupt. They may add or remove any timer,
+ * including their own, which stops a periodic timer */
+
+/* timer_ticks_get() is the low half of timer_stamp_get(). It wraps after
+ * about 20 minutes at /8, which differences of two ticks survive */
+
+extern void timer_init(uint8_t priority);
+extern uint32_t timer_ticks_get(void);
+extern uint64_t timer_stamp_get(void);
+extern uint64_t timer_ticks_ns(uint64_t ticks);
+extern uint32_t timer_ticks_us100(uint64_t ticks);
+extern void timer_phase_mark(uint32_t phase);
+extern uint64_t timer_phase_stamp_get(uint32_t phase);
+extern uint32_t timer_phase_ticks_get(uint32_t from, uint32_t to);
+extern int32_t timer_add(struct timer *timer);
+extern int32_t timer_remove(struct timer *timer);
+
+#endif /* !TIMER_H_ */
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#include <yaul.h>
+
+#include <stdio.h>
+
+#include "memoryBenchmark.h"
+
+#define BLOCK_SIZE_MIN          (1024)
+/* Each size is four times the previous one, the last one is the whole
+ * region */
+#define BLOCK_SIZE_SHIFT        (2)
+
+#define BLOCK_PATTERN           (0xDEADBEEF)
+
+/* Sequential long accesses, one 16-byte cache line per iteration */
+
+uint32_t testBlockRead(const testsuite_t *test) {
+  const volatile uint32_t *p = (const volatile uint32_t *)test->addr;
+  const volatile uint32_t * const end = p + (test->size >> 2);
+  uint32_t sum = 0;
+  for (; p < end; p += 4) {
+    sum += p[0];
+    sum += p[1];
+    sum += p[2];
+    sum += p[3];
+  }
+  val32 = sum;
+  return test->size;
+}
+
+uint32_t testBlockWrite(const testsuite_t *test) {
+  volatile uint32_t *p = (volatile uint32_t *)test->addr;
+  volatile uint32_t * const end = p + (test->size >> 2);
+  for (; p < end; p += 4) {
+    p[0] = BLOCK_PATTERN;
+    p[1] = BLOCK_PATTERN;
+    p[2] = BLOCK_PATTERN;
+    p[3] = BLOCK_PATTERN;
+  }
+  return test->size;
+}
+
+/* Copy the lower half of the block into the upper half */
+static uint32_t testBlockCopy(const testsuite_t *test) {
+  const uint32_t half = test->size >> 1;
+  const volatile uint32_t *s = (const volatile uint32_t *)test->addr;
+  const volatile uint32_t * const end = s + (half >> 2);
+  volatile uint32_t *d = (volatile uint32_t *)(test->addr + half);
+  for (; s < end; s += 4, d += 4) {
+    d[0] = s[0];
+    d[1] = s[1];
+    d[2] = s[2];
+    d[3] = s[3];
+  }
+  /* Every byte is read once and written once */
+  return test->size;
+}
+
+typedef struct {
+  char name[6];
+  uint8_t flags; /* Region capability required by the kernel */
+  testFunc func;
+} block_kernel_t;
+
+static const block_kernel_t _block_kernels[] = {
+  {"Blk W", REGION_WRITE,               testBlockWrite},
+  {"Blk R", REGION_READ,                testBlockRead},
+  {"Blk C", REGION_READ | REGION_WRITE, testBlockCopy},
+};
+
+#define NUMBER_OF_BLOCK_KERNELS (sizeof(_block_kernels) / sizeof(_block_kernels[0]))
+
+void
+bandwidth_tests_generate(const region_t *region)
+{
+        uint32_t k;
+
+        /* Registers are not blocks */
+        if ((region->widths & ACCESS_LONG) == 0) {
+                return;
+        }
+
+        for (k = 0; k < NUMBER_OF_BLOCK_KERNELS; k++) {
+                const block_kernel_t * const kernel = &_block_kernels[k];
+
+                if ((region->flags & kernel->flags) != kernel->flags) {
+                        continue;
+                }
+
+                uint32_t size = BLOCK_SIZE_MIN;
+                while (size <= region->size) {
+                        testsuite_t * const test =
+                            test_alloc(region, kernel->func, TEST_UNIT_BYTE);
+
+                        if (test == NULL) {
+                                return;
+                        }
+
+                        test->size = size;
+
+                        if (size >= 0x00100000) {
+                                (void)snprintf(test->name, sizeof(test->name),
+                                    "%-8s %s %3luM", region->name, kernel->name,
+                                    size >> 20);
+                        } else {
+                                (void)snprintf(test->name, sizeof(test->name),
+                                    "%-8s %s %3luK", region->name, kernel->name,
+                                    size >> 10);
+                        }
+
+                        if (size == region->size) {
+                                break;
+                        }
+
+                        size <<= BLOCK_SIZE_SHIFT;
+
+                        if (size > region->size) {
+                                size = region->size;
+                        }
+                }
+        }
+}
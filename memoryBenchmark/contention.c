@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#include <yaul.h>
+
+#include <stdio.h>
+
+#include "memoryBenchmark.h"
+
+/* Size of the block streamed by both CPUs */
+#define CONTENTION_BLOCK_SIZE   (4096)
+
+#define MAX_NUMBER_OF_CONTENTION_TESTS 128
+
+typedef struct {
+  char name[2];
+  testFunc func;
+} slave_kernel_t;
+
+static const slave_kernel_t _slave_kernels[] = {
+  {"R", testBlockRead},
+  {"W", testBlockWrite},
+};
+
+#define NUMBER_OF_SLAVE_KERNELS (sizeof(_slave_kernels) / sizeof(_slave_kernels[0]))
+
+/* What the slave runs while the master measures */
+typedef struct {
+  testsuite_t test;
+  bool run;     /* Set by the master, the slave stops when cleared */
+  bool running; /* Set by the slave while it runs the kernel */
+} slave_job_t;
+
+static slave_job_t _slave_job;
+
+/* Slave kernel and region for each contention test; func is NULL when the
+ * slave stays idle */
+static testsuite_t _slave_tests[MAX_NUMBER_OF_CONTENTION_TESTS];
+static uint32_t _slave_test_count = 0;
+
+/* Both CPUs have their own cache, so the job is only ever accessed through
+ * its cache-through alias */
+static volatile slave_job_t *
+_slave_job_get(void)
+{
+        return (volatile slave_job_t *)((uintptr_t)&_slave_job | CACHE_THROUGH_BIT);
+}
+
+static void
+_slave_entry(void)
+{
+        volatile slave_job_t * const job = _slave_job_get();
+
+        job->running = true;
+
+        while (job->run) {
+                job->test.func((const testsuite_t *)&job->test);
+        }
+
+        job->running = false;
+}
+
+static void
+_contention_prepare(const testsuite_t *test)
+{
+        const testsuite_t * const slave_test = test->work;
+
+        if (slave_test->func == NULL) {
+                return;
+        }
+
+        volatile slave_job_t * const job = _slave_job_get();
+
+        job->test.func = slave_test->func;
+        job->test.addr = slave_test->addr;
+        job->test.size = slave_test->size;
+        job->run = true;
+        job->running = false;
+
+        cpu_dual_slave_notify();
+
+        while (!job->running) {
+        }
+}
+
+static void
+_contention_finish(const testsuite_t *test)
+{
+        const testsuite_t * const slave_test = test->work;
+
+        if (slave_test->func == NULL) {
+                return;
+        }
+
+        volatile slave_job_t * const job = _slave_job_get();
+
+        job->run = false;
+
+        while (job->running) {
+        }
+}
+
+static bool
+_region_contended(const region_t *region)
+{
+        if (region->size < (2 * CONTENTION_BLOCK_SIZE)) {
+                return false;
+        }
+
+        if ((region->widths & ACCESS_LONG) == 0) {
+                return false;
+        }
+
+        return ((region->flags & (REGION_READ | REGION_WRITE)) ==
+            (REGION_READ | REGION_WRITE));
+}
+
+static testsuite_t *
+_contention_test_alloc(const region_t *master, const region_t *slave,
+    const slave_kernel_t *kernel)
+{
+        if (_slave_test_count >= MAX_NUMBER_OF_CONTENTION_TESTS) {
+                return NULL;
+        }
+
+        testsuite_t * const test = test_alloc(master, testBlockRead, TEST_UNIT_BYTE);
+
+        if (test == NULL) {
+                return NULL;
+        }
+
+        testsuite_t * const slave_test = &_slave_tests[_slave_test_count];
+
+        _slave_test_count++;
+
+        (void)memset(slave_test, 0x00, sizeof(testsuite_t));
+
+        /* The master always measures cache-through so that every access
+         * goes out on the bus */
+        test->size = CONTENTION_BLOCK_SIZE;
+        test->cached = false;
+        test->prepare = _contention_prepare;
+        test->finish = _contention_finish;
+        test->work = slave_test;
+
+        if (slave == NULL) {
+                (void)snprintf(test->name, sizeof(test->name), "%-8s/-",
+                    master->name);
+
+                return test;
+        }
+
+        /* The slave streams through the upper half of its window so that it
+         * never touches the block the master reads */
+        slave_test->func = kernel->func;
+        slave_test->addr = slave->addr + (slave->size / 2);
+        slave_test->size = CONTENTION_BLOCK_SIZE;
+
+        (void)snprintf(test->name, sizeof(test->name), "%-8s/%-8s%s",
+            master->name, slave->name, kernel->name);
+
+        return test;
+}
+
+void
+contention_tests_generate(const region_t *regions, uint32_t count)
+{
+        uint32_t m;
+        uint32_t s;
+        uint32_t k;
+
+        for (m = 0; m < count; m++) {
+                const region_t * const master = &regions[m];
+
+                if (!_region_contended(master)) {
+                        continue;
+                }
+
+                /* Master alone, the reference for the slowdown */
+                testsuite_t * const baseline =
+                    _contention_test_alloc(master, NULL, NULL);
+
+                if (baseline == NULL) {
+                        return;
+                }
+
+                for (s = 0; s < count; s++) {
+                        const region_t * const slave = &regions[s];
+
+                        if (!_region_contended(slave)) {
+                                continue;
+                        }
+
+                        for (k = 0; k < NUMBER_OF_SLAVE_KERNELS; k++) {
+                                testsuite_t * const test =
+                                    _contention_test_alloc(master, slave,
+                                        &_slave_kernels[k]);
+
+                                if (test == NULL) {
+                                        return;
+                                }
+
+                                test->baseline = baseline;
+                        }
+                }
+        }
+}
+
+void
+contention_init(void)
+{
+        _slave_job_get()->run = false;
+        _slave_job_get()->running = false;
+
+        cpu_dual_comm_mode_set(CPU_DUAL_ENTRY_POLLING);
+        cpu_dual_slave_set(_slave_entry);
+}
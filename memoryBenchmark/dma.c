@@ -0,0 +1,349 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#include <yaul.h>
+
+#include <stdio.h>
+
+#include "memoryBenchmark.h"
+#include "scudma.h"
+
+#define DMA_SIZE_MIN            (16)
+#define DMA_SIZE_MAX            (65536)
+/* Each size is four times the previous one */
+#define DMA_SIZE_SHIFT          (2)
+
+/* Transfer size of the CPU overlap tests */
+#define DMA_OVERLAP_SIZE        (DMA_SIZE_MAX)
+
+#define DMA_ENGINE_CPU          0
+#define DMA_ENGINE_SCU          1
+#define DMA_ENGINE_DMAC         2
+#define DMA_ENGINE_COUNT        3
+
+#define DMA_DMAC_CHANNEL        0
+
+/* SH-2 DMAC channel 0 control register, transfer end flag */
+#define CPU_DMAC_CHCR0          (0xFFFFFF8C)
+#define CPU_DMAC_CHCR_TE        (1 << 1)
+
+#define MAX_NUMBER_OF_DMA_TESTS 384
+
+typedef struct {
+  uintptr_t src;
+  uintptr_t dst;
+  scu_dma_handle_t scu_handle;
+  cpu_dmac_cfg_t dmac_cfg;
+} dma_job_t;
+
+static dma_job_t _dma_jobs[MAX_NUMBER_OF_DMA_TESTS];
+static uint32_t _dma_job_count = 0;
+
+static const char * const _engine_names[DMA_ENGINE_COUNT] = {
+  "CPU",
+  "SCU",
+  "DMA"
+};
+
+/* Register-only arithmetic standing in for unrelated game code; it never
+ * touches the bus so it only competes with the DMA for polling */
+static uint32_t _work_value = 1;
+
+static inline uint32_t
+_work_chunk(uint32_t x)
+{
+        uint32_t i;
+
+        for (i = 0; i < 16; i++) {
+                x = (x * 1103515245) + 12345;
+        }
+
+        return x;
+}
+
+static inline bool
+_dmac_busy(void)
+{
+        return ((*(volatile uint32_t *)CPU_DMAC_CHCR0 & CPU_DMAC_CHCR_TE) == 0);
+}
+
+static uint32_t testCpuCopy(const testsuite_t *test) {
+  const dma_job_t * const job = test->work;
+  const volatile uint32_t *s = (const volatile uint32_t *)job->src;
+  const volatile uint32_t * const end = s + (test->size >> 2);
+  volatile uint32_t *d = (volatile uint32_t *)job->dst;
+  for (; s < end; s += 4, d += 4) {
+    d[0] = s[0];
+    d[1] = s[1];
+    d[2] = s[2];
+    d[3] = s[3];
+  }
+  return test->size;
+}
+
+/* The level is configured by the prepare hook and is not updated by a
+ * transfer, so each call only restarts it */
+static uint32_t testScuDma(const testsuite_t *test) {
+  scudma_start();
+  scudma_wait();
+  return test->size;
+}
+
+/* The channel counter is consumed by a transfer, so each call has to
+ * program the channel again, as any caller of the DMAC would */
+static uint32_t testDmac(const testsuite_t *test) {
+  const dma_job_t * const job = test->work;
+  cpu_dmac_channel_config_set(&job->dmac_cfg);
+  cpu_dmac_channel_start(DMA_DMAC_CHANNEL);
+  while (_dmac_busy()) {
+  }
+  return test->size;
+}
+
+static uint32_t testWork(const testsuite_t *test __unused) {
+  _work_value = _work_chunk(_work_value);
+  return 1;
+}
+
+static uint32_t testScuDmaOverlap(const testsuite_t *test __unused) {
+  uint32_t x = _work_value;
+  uint32_t chunks = 0;
+  scudma_start();
+  do {
+    x = _work_chunk(x);
+    chunks++;
+  } while (scudma_busy());
+  _work_value = x;
+  return chunks;
+}
+
+static uint32_t testDmacOverlap(const testsuite_t *test) {
+  const dma_job_t * const job = test->work;
+  uint32_t x = _work_value;
+  uint32_t chunks = 0;
+  cpu_dmac_channel_config_set(&job->dmac_cfg);
+  cpu_dmac_channel_start(DMA_DMAC_CHANNEL);
+  do {
+    x = _work_chunk(x);
+    chunks++;
+  } while (_dmac_busy());
+  _work_value = x;
+  return chunks;
+}
+
+static void
+_scu_dma_prepare(const testsuite_t *test)
+{
+        dma_job_t * const job = test->work;
+
+        scudma_direct_config_set(&job->scu_handle, job->dst,
+            (const void *)job->src, test->size);
+}
+
+static void
+_dmac_prepare(const testsuite_t *test)
+{
+        dma_job_t * const job = test->work;
+
+        job->dmac_cfg.channel = DMA_DMAC_CHANNEL;
+        job->dmac_cfg.src_mode = CPU_DMAC_SOURCE_INCREMENT;
+        job->dmac_cfg.dst_mode = CPU_DMAC_DESTINATION_INCREMENT;
+        job->dmac_cfg.stride = CPU_DMAC_STRIDE_4_BYTES;
+        job->dmac_cfg.bus_mode = CPU_DMAC_BUS_MODE_CYCLE_STEAL;
+        job->dmac_cfg.src = job->src;
+        job->dmac_cfg.dst = job->dst;
+        job->dmac_cfg.len = test->size;
+        job->dmac_cfg.ihr = NULL;
+
+        cpu_dmac_enable();
+}
+
+static bool
+_engine_allowed(uint32_t engine, const region_t *src, const region_t *dst)
+{
+        if (engine != DMA_ENGINE_SCU) {
+                return true;
+        }
+
+        if (((src->flags | dst->flags) & REGION_NO_SCU_DMA) != 0) {
+                return false;
+        }
+
+        /* The SCU DMA can neither write to the A-bus nor transfer from the
+         * B-bus to the B-bus */
+        if ((dst->flags & REGION_BUS_A) != 0) {
+                return false;
+        }
+
+        return (((src->flags & dst->flags) & REGION_BUS_B) == 0);
+}
+
+static testsuite_t *
+_dma_test_alloc(const region_t *src, const region_t *dst, uint32_t engine,
+    testFunc func, uint8_t unit, uint32_t size)
+{
+        if (_dma_job_count >= MAX_NUMBER_OF_DMA_TESTS) {
+                return NULL;
+        }
+
+        testsuite_t * const test = test_alloc(dst, func, unit);
+
+        if (test == NULL) {
+                return NULL;
+        }
+
+        dma_job_t * const job = &_dma_jobs[_dma_job_count];
+
+        _dma_job_count++;
+
+        (void)memset(job, 0x00, sizeof(dma_job_t));
+
+        /* DMA bypasses the cache, so compare cache-through copies only */
+        job->src = src->addr;
+        job->dst = dst->addr;
+
+        test->size = size;
+        test->cached = false;
+        test->work = job;
+
+        if (engine == DMA_ENGINE_SCU) {
+                test->prepare = _scu_dma_prepare;
+        } else if (engine == DMA_ENGINE_DMAC) {
+                test->prepare = _dmac_prepare;
+        }
+
+        return test;
+}
+
+static bool
+_region_dma_source(const region_t *region)
+{
+        return ((region->flags & REGION_WORK_RAM) != 0);
+}
+
+static bool
+_region_dma_destination(const region_t *region)
+{
+        if ((region->widths & ACCESS_LONG) == 0) {
+                return false;
+        }
+
+        return ((region->flags & REGION_WRITE) != 0);
+}
+
+void
+dma_tests_generate(const region_t *regions, uint32_t count)
+{
+        uint32_t s;
+        uint32_t d;
+        uint32_t e;
+
+        /* Throughput of every engine and size, to find the break-even
+         * point against the CPU copy */
+        for (s = 0; s < count; s++) {
+                const region_t * const src = &regions[s];
+
+                if (!_region_dma_source(src)) {
+                        continue;
+                }
+
+                for (d = 0; d < count; d++) {
+                        const region_t * const dst = &regions[d];
+
+                        if ((d == s) || !_region_dma_destination(dst)) {
+                                continue;
+                        }
+
+                        uint32_t size;
+                        for (size = DMA_SIZE_MIN;
+                             (size <= DMA_SIZE_MAX) && (size <= src->size) && (size <= dst->size);
+                             size <<= DMA_SIZE_SHIFT) {
+                                static const testFunc funcs[DMA_ENGINE_COUNT] = {
+                                        testCpuCopy,
+                                        testScuDma,
+                                        testDmac
+                                };
+
+                                for (e = 0; e < DMA_ENGINE_COUNT; e++) {
+                                        if (!_engine_allowed(e, src, dst)) {
+                                                continue;
+                                        }
+
+                                        testsuite_t * const test =
+                                            _dma_test_alloc(src, dst, e, funcs[e],
+                                                TEST_UNIT_BYTE, size);
+
+                                        if (test == NULL) {
+                                                return;
+                                        }
+
+                                        if (size >= 1024) {
+                                                (void)snprintf(test->name, sizeof(test->name),
+                                                    "%s>%s %s %3luK", src->tag, dst->tag,
+                                                    _engine_names[e], size >> 10);
+                                        } else {
+                                                (void)snprintf(test->name, sizeof(test->name),
+                                                    "%s>%s %s %3luB", src->tag, dst->tag,
+                                                    _engine_names[e], size);
+                                        }
+                                }
+                        }
+                }
+        }
+
+        /* Work done by the CPU alone, then while each DMA is in flight */
+        testsuite_t * const baseline = _dma_test_alloc(&regions[0], &regions[0],
+            DMA_ENGINE_CPU, testWork, TEST_UNIT_ACCESS, 0);
+
+        if (baseline == NULL) {
+                return;
+        }
+
+        (void)snprintf(baseline->name, sizeof(baseline->name), "CPU work");
+
+        for (s = 0; s < count; s++) {
+                const region_t * const src = &regions[s];
+
+                if (!_region_dma_source(src)) {
+                        continue;
+                }
+
+                for (d = 0; d < count; d++) {
+                        const region_t * const dst = &regions[d];
+
+                        if ((d == s) || !_region_dma_destination(dst)) {
+                                continue;
+                        }
+
+                        if ((src->size < DMA_OVERLAP_SIZE) ||
+                            (dst->size < DMA_OVERLAP_SIZE)) {
+                                continue;
+                        }
+
+                        for (e = DMA_ENGINE_SCU; e < DMA_ENGINE_COUNT; e++) {
+                                if (!_engine_allowed(e, src, dst)) {
+                                        continue;
+                                }
+
+                                testsuite_t * const test =
+                                    _dma_test_alloc(src, dst, e,
+                                        (e == DMA_ENGINE_SCU) ? testScuDmaOverlap : testDmacOverlap,
+                                        TEST_UNIT_ACCESS, DMA_OVERLAP_SIZE);
+
+                                if (test == NULL) {
+                                        return;
+                                }
+
+                                test->baseline = baseline;
+
+                                (void)snprintf(test->name, sizeof(test->name),
+                                    "%s>%s %s|work", src->tag, dst->tag,
+                                    _engine_names[e]);
+                        }
+                }
+        }
+}
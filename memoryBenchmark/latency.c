@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#include <yaul.h>
+
+#include <stdio.h>
+
+#include "memoryBenchmark.h"
+
+#define CHASE_SIZE_MIN          (512)
+/* The working set doubles between two tests of a region */
+#define CHASE_SIZE_SHIFT        (1)
+
+/* One node per 16-byte cache line so that every load touches a new line */
+#define CHASE_NODE_SIZE         (16)
+
+#define CHASE_SEED              (0x2545F491)
+
+/* Byte offset of the next node, relative to the start of the chain */
+static uint32_t _chase_offset = 0;
+
+#define CHASE_REPEAT_16(x) x; x; x; x; x; x; x; x; x; x; x; x; x; x; x; x
+
+/* Every load depends on the previous one. Offsets rather than pointers are
+ * stored so that the same chain is valid through both aliases */
+static uint32_t testChase(const testsuite_t *test) {
+  const uintptr_t base = test->addr;
+  uint32_t offset = _chase_offset;
+  CHASE_REPEAT_16(offset = *(volatile uint32_t *)(base + offset));
+  _chase_offset = offset;
+  return 16;
+}
+
+static uint32_t
+_random_next(uint32_t *state)
+{
+        /* xorshift32 */
+        uint32_t x = *state;
+
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+
+        *state = x;
+
+        return x;
+}
+
+/* Link the nodes of the working set into a single random cycle */
+static void
+_chase_prepare(const testsuite_t *test)
+{
+        /* Build through the cache-through alias; the cache is purged before
+         * the run starts */
+        volatile uint32_t * const nodes = (volatile uint32_t *)test->through_addr;
+        const uint32_t count = test->size / CHASE_NODE_SIZE;
+        const uint32_t stride = CHASE_NODE_SIZE / sizeof(uint32_t);
+
+        uint32_t state = CHASE_SEED;
+        uint32_t i;
+
+        /* The second long of each node holds the visiting order */
+        for (i = 0; i < count; i++) {
+                nodes[(i * stride) + 1] = i;
+        }
+
+        /* Sattolo's shuffle produces a permutation made of a single cycle */
+        for (i = count - 1; i > 0; i--) {
+                const uint32_t j = _random_next(&state) % i;
+                const uint32_t tmp = nodes[(i * stride) + 1];
+
+                nodes[(i * stride) + 1] = nodes[(j * stride) + 1];
+                nodes[(j * stride) + 1] = tmp;
+        }
+
+        for (i = 0; i < count; i++) {
+                const uint32_t from = nodes[(i * stride) + 1];
+                const uint32_t to = nodes[(((i + 1) % count) * stride) + 1];
+
+                nodes[from * stride] = to * CHASE_NODE_SIZE;
+        }
+
+        _chase_offset = 0;
+}
+
+void
+latency_tests_generate(const region_t *region)
+{
+        if ((region->flags & REGION_WORK_RAM) == 0) {
+                return;
+        }
+
+        uint32_t size;
+        for (size = CHASE_SIZE_MIN; size <= region->size;
+             size <<= CHASE_SIZE_SHIFT) {
+                testsuite_t * const test =
+                    test_alloc(region, testChase, TEST_UNIT_LOAD);
+
+                if (test == NULL) {
+                        return;
+                }
+
+                test->size = size;
+                test->prepare = _chase_prepare;
+
+                if (size >= 0x00100000) {
+                        (void)snprintf(test->name, sizeof(test->name),
+                            "%-8s Ptr %3luM", region->name, size >> 20);
+                } else if (size >= 0x00000400) {
+                        (void)snprintf(test->name, sizeof(test->name),
+                            "%-8s Ptr %3luK", region->name, size >> 10);
+                } else {
+                        (void)snprintf(test->name, sizeof(test->name),
+                            "%-8s Ptr %3luB", region->name, size);
+                }
+        }
+}
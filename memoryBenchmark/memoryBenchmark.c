@@ -10,491 +10,525 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-#define CPU_FRT_INTERRUPT_PRIORITY_LEVEL 8
+#include "harness.h"
+#include "memoryBenchmark.h"
+#include "report.h"
+#include "timer.h"
 
-#define TIMER_MAX_TIMERS_COUNT 16
+/* Above every SCU interrupt, so that only the FRT overflow can be taken
+ * while a test is being measured */
+#define CPU_FRT_INTERRUPT_PRIORITY_LEVEL 15
+#define MEASURE_INTC_MASK 14
 
-#define MS_VALUE (CPU_FRT_PAL_320_128_COUNT_1MS)
-#define FRT_MS_NUMBER (200)
+#define MS_VALUE (TIMER_TICKS_1MS)
 
-#define NUMBER_OF_TESTS 12
+/* Each measured loop runs for at least this many FRT ticks */
+#define MEASURE_TICKS (10 * MS_VALUE)
+#define MEASURE_MAX_ITERATIONS (1 << 24)
 
-struct timer;
+/* Loops discarded before, and loops kept for, the statistics */
+#define MEASURE_WARMUP 2
+#define MEASURE_REPETITIONS 9
 
-struct timer_event {
-        uint32_t id;
-
-        const struct timer *timer;
-        int32_t step;
-
-        uint32_t next_interval;
-} __packed;
+static uint8_t val8;
+static uint16_t val16;
+uint32_t val32;
 
-struct timer {
-        uint32_t interval; /* Time in milliseconds */
-        void (*callback)(struct timer_event *);
-        void (*callbackStep)(struct timer_event *);
-} __packed;
+static volatile uint32_t testId = 0;
 
-struct timer_state {
-        bool valid;
-        uint32_t id;
-        struct timer event;
-        uint32_t remaining;
-} __packed;
+#define CACHE_MODE_THROUGH      0
+#define CACHE_MODE_CACHED       1
+#define CACHE_MODE_COUNT        2
+
+/* A-bus CS0 cartridge identification */
+#define CART_ID_ADDR    (0x24FFFFFF)
+#define CART_ID_1MIB    (0x5A)
+#define CART_ID_4MIB    (0x5C)
+
+/* SCU A-bus set and refresh registers */
+#define SCU_ASR0        (0x25FE00B0)
+#define SCU_AREF        (0x25FE00B8)
+
+/* Every region is accessed through a scratch window that the program, the
+ * stack, the heap and the debug console do not use. Registers are only read,
+ * at the width the bus accepts. */
+static region_t regions[] = {
+  {"HighRAM",  "HWR", 0x26080000, 0x00080000, ACCESS_BYTE | ACCESS_WORD | ACCESS_LONG, REGION_READ | REGION_WRITE | REGION_CACHED | REGION_WORK_RAM},
+  {"LowRAM",   "LWR", 0x20200000, 0x00100000, ACCESS_BYTE | ACCESS_WORD | ACCESS_LONG, REGION_READ | REGION_WRITE | REGION_CACHED | REGION_WORK_RAM | REGION_NO_SCU_DMA},
+  {"VDP1 RAM", "VD1", 0x25C40000, 0x00040000, ACCESS_BYTE | ACCESS_WORD | ACCESS_LONG, REGION_READ | REGION_WRITE | REGION_CACHED | REGION_BUS_B},
+  {"VDP1 FB",  "VFB", 0x25C80000, 0x00040000, ACCESS_BYTE | ACCESS_WORD | ACCESS_LONG, REGION_READ | REGION_WRITE | REGION_CACHED | REGION_BUS_B},
+  {"VDP2 RAM", "VD2", 0x25E40000, 0x00020000, ACCESS_BYTE | ACCESS_WORD | ACCESS_LONG, REGION_READ | REGION_WRITE | REGION_CACHED | REGION_BUS_B},
+  {"VDP2 CRM", "CRM", 0x25F00800, 0x00000800,               ACCESS_WORD | ACCESS_LONG, REGION_READ | REGION_WRITE | REGION_CACHED | REGION_BUS_B},
+  {"SCSP RAM", "SND", 0x25A40000, 0x00040000, ACCESS_BYTE | ACCESS_WORD | ACCESS_LONG, REGION_READ | REGION_WRITE | REGION_CACHED | REGION_BUS_B},
+  {"CS0 RAM0", "CR0", 0x22400000, 0x00000000, ACCESS_BYTE | ACCESS_WORD | ACCESS_LONG, REGION_READ | REGION_WRITE | REGION_OPTIONAL | REGION_CACHED | REGION_BUS_A},
+  {"CS0 RAM1", "CR1", 0x22600000, 0x00000000, ACCESS_BYTE | ACCESS_WORD | ACCESS_LONG, REGION_READ | REGION_WRITE | REGION_OPTIONAL | REGION_CACHED | REGION_BUS_A},
+  {"BIOS",     "ROM", 0x20000000, 0x00080000, ACCESS_BYTE | ACCESS_WORD | ACCESS_LONG, REGION_READ | REGION_CACHED},
+  {"SCU REG",  "SCU", 0x25FE00C8, 0x00000004,                             ACCESS_LONG, REGION_READ},
+  {"VDP1 REG", "V1R", 0x25D00010, 0x00000002,               ACCESS_WORD,               REGION_READ | REGION_BUS_B},
+  {"VDP2 REG", "V2R", 0x25F80004, 0x00000002,               ACCESS_WORD,               REGION_READ | REGION_BUS_B},
+};
 
-static struct timer_state _timer_states[TIMER_MAX_TIMERS_COUNT];
+#define NUMBER_OF_REGIONS (sizeof(regions) / sizeof(regions[0]))
 
-static uint32_t _next_timer = 0;
-static uint32_t _id_count = 0;
+#define ACCESS_REPEAT_10(x) x; x; x; x; x; x; x; x; x; x
 
-static void _timer_init(void);
-static int32_t _timer_add(const struct timer *);
-static int32_t _timer_remove(uint32_t) __unused;
+#define ACCESS_WRITE_KERNEL(fn, type)                       \
+static uint32_t fn(const testsuite_t *test) {               \
+  volatile type *p = (volatile type *)test->addr;           \
+  ACCESS_REPEAT_10(*p = 0xDE);                              \
+  return 10;                                                \
+}
 
-/* Master */
-static void _frt_compare_output_handler(void);
-static void _timer_handler(struct timer_event *);
-static void _timer_step_handler(struct timer_event *);
+#define ACCESS_READ_KERNEL(fn, type, dst)                   \
+static uint32_t fn(const testsuite_t *test) {               \
+  volatile type *p = (volatile type *)test->addr;           \
+  ACCESS_REPEAT_10(dst = *p);                               \
+  return 10;                                                \
+}
 
-static volatile uint32_t counter [NUMBER_OF_TESTS] = {0};
+ACCESS_WRITE_KERNEL(testByteWrite, uint8_t)
+ACCESS_WRITE_KERNEL(testWordWrite, uint16_t)
+ACCESS_WRITE_KERNEL(testLongWrite, uint32_t)
+ACCESS_READ_KERNEL(testByteRead, uint8_t, val8)
+ACCESS_READ_KERNEL(testWordRead, uint16_t, val16)
+ACCESS_READ_KERNEL(testLongRead, uint32_t, val32)
 
-static uint8_t val8;
-static uint16_t val16;
-static uint32_t val32;
+typedef struct {
+  char name[7];
+  uint8_t width;
+  uint8_t flags; /* Region capability required by the kernel */
+  testFunc func;
+} kernel_t;
+
+static const kernel_t kernels[] = {
+  {"W Byte", ACCESS_BYTE, REGION_WRITE, testByteWrite},
+  {"W Word", ACCESS_WORD, REGION_WRITE, testWordWrite},
+  {"W Long", ACCESS_LONG, REGION_WRITE, testLongWrite},
+  {"R Byte", ACCESS_BYTE, REGION_READ,  testByteRead},
+  {"R Word", ACCESS_WORD, REGION_READ,  testWordRead},
+  {"R Long", ACCESS_LONG, REGION_READ,  testLongRead},
+};
 
-static volatile uint32_t testId = 0;
+#define NUMBER_OF_KERNELS (sizeof(kernels) / sizeof(kernels[0]))
 
-typedef uint32_t (*testFunc) (void);
+#define MAX_NUMBER_OF_TESTS 1024
 
 typedef struct {
-  char name[20];
-  testFunc func;
-  volatile uint32_t* counter;
-} testsuite_t;
-
-static uint32_t testHighWRamByteWrite() {
-  *((volatile uint8_t *)(0x26010100)) = 0xDE;
-  *((volatile uint8_t *)(0x26010100)) = 0xDE;
-  *((volatile uint8_t *)(0x26010100)) = 0xDE;
-  *((volatile uint8_t *)(0x26010100)) = 0xDE;
-  *((volatile uint8_t *)(0x26010100)) = 0xDE;
-  *((volatile uint8_t *)(0x26010100)) = 0xDE;
-  *((volatile uint8_t *)(0x26010100)) = 0xDE;
-  *((volatile uint8_t *)(0x26010100)) = 0xDE;
-  *((volatile uint8_t *)(0x26010100)) = 0xDE;
-  *((volatile uint8_t *)(0x26010100)) = 0xDE;
-  return 10;
-}
+  uint32_t iterations; /* Fixed once calibrated, 0 until then */
+  uint32_t units;      /* Units returned by the kernel over all iterations */
+  uint32_t ticks;      /* Median FRT ticks, empty kernel baseline subtracted */
+  harness_stats_t stats; /* In FRT ticks, empty kernel baseline subtracted */
+} result_t;
 
-static uint32_t testHighWRamWordWrite() {
-  *((volatile uint16_t *)(0x26010100)) = 0xDE;
-  *((volatile uint16_t *)(0x26010100)) = 0xDE;
-  *((volatile uint16_t *)(0x26010100)) = 0xDE;
-  *((volatile uint16_t *)(0x26010100)) = 0xDE;
-  *((volatile uint16_t *)(0x26010100)) = 0xDE;
-  *((volatile uint16_t *)(0x26010100)) = 0xDE;
-  *((volatile uint16_t *)(0x26010100)) = 0xDE;
-  *((volatile uint16_t *)(0x26010100)) = 0xDE;
-  *((volatile uint16_t *)(0x26010100)) = 0xDE;
-  *((volatile uint16_t *)(0x26010100)) = 0xDE;
-  return 10;
-}
+static result_t results[MAX_NUMBER_OF_TESTS][CACHE_MODE_COUNT];
 
-static uint32_t testHighWRamLongWrite() {
-  *((volatile uint32_t *)(0x26010100)) = 0xDE;
-  *((volatile uint32_t *)(0x26010100)) = 0xDE;
-  *((volatile uint32_t *)(0x26010100)) = 0xDE;
-  *((volatile uint32_t *)(0x26010100)) = 0xDE;
-  *((volatile uint32_t *)(0x26010100)) = 0xDE;
-  *((volatile uint32_t *)(0x26010100)) = 0xDE;
-  *((volatile uint32_t *)(0x26010100)) = 0xDE;
-  *((volatile uint32_t *)(0x26010100)) = 0xDE;
-  *((volatile uint32_t *)(0x26010100)) = 0xDE;
-  *((volatile uint32_t *)(0x26010100)) = 0xDE;
-  return 10;
-}
+static testsuite_t tests[MAX_NUMBER_OF_TESTS];
+static uint32_t testCount = 0;
 
-static uint32_t testHighWRamByteRead() {
-  val8 = *((volatile uint8_t *)(0x26010100));
-  val8 = *((volatile uint8_t *)(0x26010100));
-  val8 = *((volatile uint8_t *)(0x26010100));
-  val8 = *((volatile uint8_t *)(0x26010100));
-  val8 = *((volatile uint8_t *)(0x26010100));
-  val8 = *((volatile uint8_t *)(0x26010100));
-  val8 = *((volatile uint8_t *)(0x26010100));
-  val8 = *((volatile uint8_t *)(0x26010100));
-  val8 = *((volatile uint8_t *)(0x26010100));
-  val8 = *((volatile uint8_t *)(0x26010100));
-  return 10;
-}
+static volatile uint32_t cacheMode = CACHE_MODE_THROUGH;
 
-static uint32_t testHighWRamWordRead() {
-  val16 = *((volatile uint16_t *)(0x26010100));
-  val16 = *((volatile uint16_t *)(0x26010100));
-  val16 = *((volatile uint16_t *)(0x26010100));
-  val16 = *((volatile uint16_t *)(0x26010100));
-  val16 = *((volatile uint16_t *)(0x26010100));
-  val16 = *((volatile uint16_t *)(0x26010100));
-  val16 = *((volatile uint16_t *)(0x26010100));
-  val16 = *((volatile uint16_t *)(0x26010100));
-  val16 = *((volatile uint16_t *)(0x26010100));
-  val16 = *((volatile uint16_t *)(0x26010100));
-  return 10;
-}
+testsuite_t *
+test_alloc(const region_t *region, testFunc func, uint8_t unit)
+{
+        if (testCount >= MAX_NUMBER_OF_TESTS) {
+                return NULL;
+        }
 
+        testsuite_t * const test = &tests[testCount];
 
-static uint32_t testHighWRamLongRead() {
-  val32 = *((volatile uint32_t *)(0x26010100));
-  val32 = *((volatile uint32_t *)(0x26010100));
-  val32 = *((volatile uint32_t *)(0x26010100));
-  val32 = *((volatile uint32_t *)(0x26010100));
-  val32 = *((volatile uint32_t *)(0x26010100));
-  val32 = *((volatile uint32_t *)(0x26010100));
-  val32 = *((volatile uint32_t *)(0x26010100));
-  val32 = *((volatile uint32_t *)(0x26010100));
-  val32 = *((volatile uint32_t *)(0x26010100));
-  val32 = *((volatile uint32_t *)(0x26010100));
-  return 10;
-}
+        (void)memset(test, 0x00, sizeof(testsuite_t));
 
+        test->func = func;
+        test->addr = region->addr;
+        test->through_addr = region->addr;
+        test->unit = unit;
+        test->cached = ((region->flags & REGION_CACHED) != 0);
 
-static uint32_t testLowWRamByteWrite(void){
-  *((volatile uint8_t *)(0x20240100)) = 0xDE;
-  *((volatile uint8_t *)(0x20240100)) = 0xDE;
-  *((volatile uint8_t *)(0x20240100)) = 0xDE;
-  *((volatile uint8_t *)(0x20240100)) = 0xDE;
-  *((volatile uint8_t *)(0x20240100)) = 0xDE;
-  *((volatile uint8_t *)(0x20240100)) = 0xDE;
-  *((volatile uint8_t *)(0x20240100)) = 0xDE;
-  *((volatile uint8_t *)(0x20240100)) = 0xDE;
-  *((volatile uint8_t *)(0x20240100)) = 0xDE;
-  *((volatile uint8_t *)(0x20240100)) = 0xDE;
-  return 10;
-}
+        testCount++;
 
-static uint32_t testLowWRamWordWrite(void){
-  *((volatile uint16_t *)(0x20240100)) = 0xDE;
-  *((volatile uint16_t *)(0x20240100)) = 0xDE;
-  *((volatile uint16_t *)(0x20240100)) = 0xDE;
-  *((volatile uint16_t *)(0x20240100)) = 0xDE;
-  *((volatile uint16_t *)(0x20240100)) = 0xDE;
-  *((volatile uint16_t *)(0x20240100)) = 0xDE;
-  *((volatile uint16_t *)(0x20240100)) = 0xDE;
-  *((volatile uint16_t *)(0x20240100)) = 0xDE;
-  *((volatile uint16_t *)(0x20240100)) = 0xDE;
-  *((volatile uint16_t *)(0x20240100)) = 0xDE;
-  return 10;
+        return test;
 }
 
-static uint32_t testLowWRamLongWrite(void){
-  *((volatile uint32_t *)(0x20240100)) = 0xDE;
-  *((volatile uint32_t *)(0x20240100)) = 0xDE;
-  *((volatile uint32_t *)(0x20240100)) = 0xDE;
-  *((volatile uint32_t *)(0x20240100)) = 0xDE;
-  *((volatile uint32_t *)(0x20240100)) = 0xDE;
-  *((volatile uint32_t *)(0x20240100)) = 0xDE;
-  *((volatile uint32_t *)(0x20240100)) = 0xDE;
-  *((volatile uint32_t *)(0x20240100)) = 0xDE;
-  *((volatile uint32_t *)(0x20240100)) = 0xDE;
-  *((volatile uint32_t *)(0x20240100)) = 0xDE;
-  return 10;
-}
+/* The cartridge DRAM is two banks, at 0x22400000 and 0x22600000. Those of
+ * a 1 MiB cartridge are 512 KiB each, with a gap after the first, and those
+ * of a 4 MiB cartridge 2 MiB each. Returns the size of a bank, 0 without a
+ * cartridge */
+static uint32_t
+_cart_bank_size_get(void)
+{
+        const uint8_t id = *(volatile uint8_t *)CART_ID_ADDR;
 
-static uint32_t testLowWRamByteRead() {
-  val8 = *((volatile uint8_t *)(0x20240100));
-  val8 = *((volatile uint8_t *)(0x20240100));
-  val8 = *((volatile uint8_t *)(0x20240100));
-  val8 = *((volatile uint8_t *)(0x20240100));
-  val8 = *((volatile uint8_t *)(0x20240100));
-  val8 = *((volatile uint8_t *)(0x20240100));
-  val8 = *((volatile uint8_t *)(0x20240100));
-  val8 = *((volatile uint8_t *)(0x20240100));
-  val8 = *((volatile uint8_t *)(0x20240100));
-  val8 = *((volatile uint8_t *)(0x20240100));
-  return 10;
-}
+        if ((id != CART_ID_1MIB) && (id != CART_ID_4MIB)) {
+                return 0;
+        }
 
-static uint32_t testLowWRamWordRead() {
-  val16 = *((volatile uint16_t *)(0x20240100));
-  val16 = *((volatile uint16_t *)(0x20240100));
-  val16 = *((volatile uint16_t *)(0x20240100));
-  val16 = *((volatile uint16_t *)(0x20240100));
-  val16 = *((volatile uint16_t *)(0x20240100));
-  val16 = *((volatile uint16_t *)(0x20240100));
-  val16 = *((volatile uint16_t *)(0x20240100));
-  val16 = *((volatile uint16_t *)(0x20240100));
-  val16 = *((volatile uint16_t *)(0x20240100));
-  val16 = *((volatile uint16_t *)(0x20240100));
-  return 10;
+        /* Configure the A-bus for the DRAM cartridge */
+        *(volatile uint32_t *)SCU_ASR0 = 0x23301FF0;
+        *(volatile uint32_t *)SCU_AREF = 0x00000013;
+
+        return (id == CART_ID_1MIB) ? 0x00080000 : 0x00200000;
 }
 
+static void
+_tests_generate(void)
+{
+        uint32_t r;
+        uint32_t k;
 
-static uint32_t testLowWRamLongRead() {
-  val32 = *((volatile uint32_t *)(0x20240100));
-  val32 = *((volatile uint32_t *)(0x20240100));
-  val32 = *((volatile uint32_t *)(0x20240100));
-  val32 = *((volatile uint32_t *)(0x20240100));
-  val32 = *((volatile uint32_t *)(0x20240100));
-  val32 = *((volatile uint32_t *)(0x20240100));
-  val32 = *((volatile uint32_t *)(0x20240100));
-  val32 = *((volatile uint32_t *)(0x20240100));
-  val32 = *((volatile uint32_t *)(0x20240100));
-  val32 = *((volatile uint32_t *)(0x20240100));
-  return 10;
-}
+        testCount = 0;
 
-testsuite_t tests[NUMBER_OF_TESTS] = {
-  {"HighRAM W Byte", testHighWRamByteWrite, &counter[0]},
-  {"HighRAM W Word", testHighWRamWordWrite, &counter[1]},
-  {"HighRAM W Long", testHighWRamLongWrite, &counter[2]},
-  {"HighRAM R Byte", testHighWRamByteRead,  &counter[3]},
-  {"HighRAM R Word", testHighWRamWordRead,  &counter[4]},
-  {"HighRAM R Long", testHighWRamLongRead,  &counter[5]},
-  {"LowRAM  W Byte", testLowWRamByteWrite,  &counter[6]},
-  {"LowRAM  W Word", testLowWRamWordWrite,  &counter[7]},
-  {"LowRAM  W Long", testLowWRamLongWrite,  &counter[8]},
-  {"LowRAM  R Byte", testLowWRamByteRead,  &counter[9]},
-  {"LowRAM  R Word", testLowWRamWordRead,  &counter[10]},
-  {"LowRAM  R Long", testLowWRamLongRead,  &counter[11]},
-};
+        for (r = 0; r < NUMBER_OF_REGIONS; r++) {
+                region_t * const region = &regions[r];
 
-volatile bool testing = false;
+                if ((region->flags & REGION_OPTIONAL) != 0) {
+                        region->size = _cart_bank_size_get();
+                }
 
-void
-main(void)
-{
-        dbgio_dev_default_init(DBGIO_DEV_VDP2_ASYNC);
-        dbgio_dev_font_load();
-        dbgio_dev_font_load_wait();
+                if (region->size == 0) {
+                        continue;
+                }
 
-        _timer_init();
+                for (k = 0; k < NUMBER_OF_KERNELS; k++) {
+                        const kernel_t * const kernel = &kernels[k];
 
-        struct timer match1 __unused = {
-                .interval = 1000/FRT_MS_NUMBER,
-                .callback = _timer_handler,
-                .callbackStep = _timer_step_handler,
-        };
+                        if ((region->widths & kernel->width) == 0) {
+                                continue;
+                        }
 
-        _timer_add(&match1);
+                        if ((region->flags & kernel->flags) == 0) {
+                                continue;
+                        }
 
-        cpu_cache_purge();
-        cpu_cache_enable();
+                        testsuite_t * const test =
+                            test_alloc(region, kernel->func, TEST_UNIT_ACCESS);
 
-        testId = 0;
-        testing = true;
+                        if (test == NULL) {
+                                return;
+                        }
 
-        while(true) {
-          while (testing) {
-            *tests[testId].counter += tests[testId].func();
-          }
-          dbgio_puts("[1;1H[2J");
-          int start = (testId/10)*10;
-          int end = (testId/10)*10 + 10;
-          if (end > NUMBER_OF_TESTS) end = NUMBER_OF_TESTS;
-          for (int i=start; i< end; i++)
-          dbgio_printf("\n"
-                      "%s : %lu access/s\n",
-                       tests[i].name,
-                       *tests[i].counter);
-          dbgio_flush();
-          testId++;
-          testId %= NUMBER_OF_TESTS;
-          *tests[testId].counter = 0;
-          vdp_sync();
-          cpu_frt_count_set(0);
-          testing = true;
+                        (void)snprintf(test->name, sizeof(test->name), "%-8s %s",
+                            region->name, kernel->name);
+                }
+
+                bandwidth_tests_generate(region);
+                latency_tests_generate(region);
         }
+
+        contention_tests_generate(regions, NUMBER_OF_REGIONS);
+        dma_tests_generate(regions, NUMBER_OF_REGIONS);
 }
 
-void
-user_init(void)
+/* Select the alias and the cache state for the next run of a test */
+static void
+_test_prepare(testsuite_t *test, uint32_t mode)
 {
-        vdp2_tvmd_display_res_set(VDP2_TVMD_INTERLACE_NONE, VDP2_TVMD_HORZ_NORMAL_A,
-            VDP2_TVMD_VERT_224);
+        if (mode == CACHE_MODE_CACHED) {
+                test->addr = test->through_addr & ~CACHE_THROUGH_BIT;
+        } else {
+                test->addr = test->through_addr;
+        }
 
-        vdp2_scrn_back_screen_color_set(VDP2_VRAM_ADDR(3, 0x01FFFE),
-            COLOR_RGB1555(1, 0, 3, 3));
+        if (test->prepare != NULL) {
+                test->prepare(test);
+        }
 
-        cpu_intc_mask_set(0);
+        /* Start every run from a cold cache so that lines left by the
+         * previous run do not leak into this one */
+        cpu_cache_purge();
+        cpu_cache_enable();
+}
 
-        vdp2_tvmd_display_set();
+/* Calls nothing but the kernel's own call overhead */
+static uint32_t testEmpty(const testsuite_t *test __unused) {
+  return 0;
 }
 
-static void
-_frt_compare_output_handler(void)
+static uint32_t
+_test_loop(const testsuite_t *test, testFunc func, uint32_t iterations,
+    uint32_t *units)
 {
-        uint32_t frt_count;
-        frt_count = cpu_frt_count_get();
+        uint32_t u = 0;
+        uint32_t i;
 
-        int32_t count_diff __unused;
-        count_diff = frt_count - (FRT_MS_NUMBER * MS_VALUE);
+        const uint32_t start = timer_ticks_get();
 
-        if (count_diff >= 0) {
-                cpu_frt_count_set(count_diff);
+        for (i = 0; i < iterations; i++) {
+                u += func(test);
         }
 
-        uint32_t i;
-        for (i = 0; i < TIMER_MAX_TIMERS_COUNT; i++) {
-                struct timer_state *timer_state;
-                struct timer_event event;
-                timer_state = &_timer_states[i];
-
-                event.id = timer_state->id;
-                event.timer = &timer_state->event;
-                event.next_interval = timer_state->event.interval;
-                event.step = count_diff;
-
-                /* Invalid timer */
-                if (!timer_state->valid) {
-                        continue;
-                }
+        const uint32_t end = timer_ticks_get();
 
-                timer_state->remaining--;
+        *units = u;
 
-                timer_state->event.callbackStep (&event);
+        return end - start;
+}
 
-                if (timer_state->remaining != 0) {
-                        continue;
-                }
+static void
+_test_measure(const testsuite_t *test, uint32_t mode)
+{
+        result_t * const result = &results[test - tests][mode];
 
+        harness_t harness;
+        harness_stats_t empty_stats;
 
+        uint32_t units;
+        uint32_t ticks;
 
-                timer_state->event.callback (&event);
+        const uint32_t i_mask = cpu_intc_mask_get();
 
-                if (event.next_interval > 0) {
-                        /* Choose the next non-zero interval */
-                        timer_state->remaining = event.next_interval;
+        cpu_intc_mask_set(MEASURE_INTC_MASK);
 
-                        continue;
+        /* The first run of a test finds how many iterations fill the
+         * measurement time. That count is then kept, so every later run
+         * does exactly the same work */
+        if (result->iterations == 0) {
+                uint32_t iterations = 1;
+
+                while (iterations < MEASURE_MAX_ITERATIONS) {
+                        ticks = _test_loop(test, test->func, iterations, &units);
+
+                        if (ticks >= MEASURE_TICKS) {
+                                break;
+                        }
+
+                        iterations <<= 1;
                 }
 
-                /* Invalidate the timer */
-                timer_state->valid = false;
+                result->iterations = iterations;
         }
+
+        harness_init(&harness, MEASURE_WARMUP, MEASURE_REPETITIONS);
+
+        do {
+                ticks = _test_loop(test, testEmpty, result->iterations, &units);
+        } while (!harness_sample_add(&harness, ticks));
+
+        harness_stats_get(&harness, &empty_stats);
+
+        harness_init(&harness, MEASURE_WARMUP, MEASURE_REPETITIONS);
+
+        do {
+                ticks = _test_loop(test, test->func, result->iterations, &units);
+                ticks = (ticks > empty_stats.median) ? (ticks - empty_stats.median) : 0;
+        } while (!harness_sample_add(&harness, ticks));
+
+        cpu_intc_mask_set(i_mask);
+
+        harness_stats_get(&harness, &result->stats);
+
+        result->units = units;
+        result->ticks = result->stats.median;
 }
 
+/* Format FRT ticks as microseconds */
 static void
-_timer_init(void)
+_ticks_format(char *buffer, size_t size, uint32_t ticks)
 {
-        uint32_t timer;
-        for (timer = 0; timer < TIMER_MAX_TIMERS_COUNT; timer++) {
-                _timer_states[timer].valid = false;
-        }
+        const uint32_t us100 = timer_ticks_us100(ticks);
 
-        cpu_frt_init(CPU_FRT_CLOCK_DIV_128);
-        cpu_frt_oca_set((FRT_MS_NUMBER * MS_VALUE), _frt_compare_output_handler);
-        /* Match every 9.525μs */
-        cpu_frt_count_set(0);
-        cpu_frt_interrupt_priority_set(CPU_FRT_INTERRUPT_PRIORITY_LEVEL);
+        (void)snprintf(buffer, size, "%7lu.%02lu", us100 / 100, us100 % 100);
 }
 
-static int32_t
-_timer_add(const struct timer *timer)
+/* Spread of the loop times of the last run, all in microseconds */
+static void
+_test_stats_print(const testsuite_t *test, uint32_t mode)
 {
-        /* Disable interrupts */
-        uint32_t i_mask;
-        i_mask = cpu_intc_mask_get();
+        const harness_stats_t * const stats = &results[test - tests][mode].stats;
+
+        char min[11];
+        char median[11];
+        char max[11];
+        char stddev[11];
+
+        _ticks_format(min, sizeof(min), stats->min);
+        _ticks_format(median, sizeof(median), stats->median);
+        _ticks_format(max, sizeof(max), stats->max);
+        _ticks_format(stddev, sizeof(stddev), stats->stddev);
+
+        dbgio_printf("\n"
+                    "%-19s %s n=%lu-%lu\n"
+                    "min %s med %s us\n"
+                    "max %s sd  %s us\n",
+                     test->name,
+                     (mode == CACHE_MODE_CACHED) ? "cached " : "through",
+                     stats->count,
+                     stats->rejected,
+                     min, median,
+                     max, stddev);
+}
 
-        cpu_intc_mask_set(15);
+/* Convert FRT ticks spent on a number of units into hundredths of
+ * nanoseconds per access or per load, or of MB/s for block tests */
+static uint32_t
+_ticks_value100(const testsuite_t *test, uint32_t units, uint32_t ticks)
+{
+        if (test->unit == TEST_UNIT_BYTE) {
+                const uint64_t ns = timer_ticks_ns(ticks);
 
-        if (timer->callback == NULL) {
-                return -1;
-        }
+                if (ns == 0) {
+                        return 0;
+                }
 
-        if (timer->callbackStep == NULL) {
-                return -1;
+                return (uint32_t)(((uint64_t)units * 100000) / ns);
         }
 
-        if (timer->interval == 0) {
-                return -1;
+        if (units == 0) {
+                return 0;
         }
 
-        struct timer_state *timer_state;
-        timer_state = &_timer_states[_next_timer & 0x1F];
-
-        if (timer_state->valid) {
-                /* Look for a free timer */
-                uint32_t timer;
-                for (timer = 0; timer < TIMER_MAX_TIMERS_COUNT; timer++) {
-                        timer_state = &_timer_states[timer];
+        return (uint32_t)((timer_ticks_ns(ticks) * 100) / units);
+}
 
-                        if (!timer_state->valid) {
-                                break;
-                        }
-                }
+/* Format a result as nanoseconds per access or per load, or as MB/s for
+ * block tests */
+static void
+_test_value_format(char *buffer, size_t size, const testsuite_t *test,
+    const result_t *result)
+{
+        if ((result->units == 0) || (result->ticks == 0)) {
+                (void)snprintf(buffer, size, "%9s", "?");
 
-                _next_timer = timer;
-        } else {
-                _next_timer++;
+                return;
         }
 
-        if (_next_timer > TIMER_MAX_TIMERS_COUNT) {
-                return -1;
-        }
+        const uint32_t value100 =
+            _ticks_value100(test, result->units, result->ticks);
 
-        timer_state->id = _id_count;
-        memcpy(&timer_state->event, timer, sizeof(struct timer));
-        timer_state->remaining = timer->interval;
+        (void)snprintf(buffer, size, "%6lu.%02lu", value100 / 100, value100 % 100);
+}
 
-        timer_state->valid = true;
+/* Stream the statistics of the last run, in the unit they are displayed in */
+static void
+_test_report(const testsuite_t *test, uint32_t mode)
+{
+        const result_t * const result = &results[test - tests][mode];
+        const harness_stats_t * const ticks = &result->stats;
 
-        _id_count++;
+        harness_stats_t stats = *ticks;
 
-        /* Enable interrupts */
-        cpu_intc_mask_set(i_mask);
+        if ((result->units == 0) || (ticks->min == 0)) {
+                return;
+        }
 
-        return 0;
+        stats.median = _ticks_value100(test, result->units, ticks->median);
+        stats.mean = _ticks_value100(test, result->units, ticks->mean);
+
+        if (test->unit == TEST_UNIT_BYTE) {
+                /* The fastest loop gives the highest bandwidth */
+                stats.min = _ticks_value100(test, result->units, ticks->max);
+                stats.max = _ticks_value100(test, result->units, ticks->min);
+                stats.stddev = (ticks->median == 0) ? 0 :
+                    (uint32_t)(((uint64_t)stats.median * ticks->stddev) / ticks->median);
+        } else {
+                stats.min = _ticks_value100(test, result->units, ticks->min);
+                stats.max = _ticks_value100(test, result->units, ticks->max);
+                stats.stddev = _ticks_value100(test, result->units, ticks->stddev);
+        }
+
+        report_stats(test->name,
+            (mode == CACHE_MODE_CACHED) ? "cached" : "through",
+            (test->unit == TEST_UNIT_BYTE) ? "MB/s" : "ns",
+            &stats);
 }
 
-static int32_t
-_timer_remove(uint32_t id)
+static void
+_test_print(const testsuite_t *test)
 {
-        int32_t ret;
+        const uint32_t i = test - tests;
+        const result_t * const result = &results[i][CACHE_MODE_THROUGH];
 
-        /* Disable interrupts */
-        uint32_t i_mask;
-        i_mask = cpu_intc_mask_get();
+        char through[10];
+        char cached[10];
 
-        cpu_intc_mask_set(15);
+        _test_value_format(through, sizeof(through), test, result);
 
-        struct timer_state *timer_state;
+        if (test->baseline != NULL) {
+                /* Second column is how many times slower than the baseline,
+                 * as the ratio of the time spent per unit */
+                const result_t * const base =
+                    &results[test->baseline - tests][CACHE_MODE_THROUGH];
 
-        uint32_t timer;
-        for (timer = 0; timer < TIMER_MAX_TIMERS_COUNT; timer++) {
-                timer_state = &_timer_states[timer];
+                const uint64_t num = (uint64_t)result->ticks * base->units;
+                const uint64_t den = (uint64_t)base->ticks * result->units;
 
-                if (timer_state->valid && (id == timer_state->id)) {
-                        break;
-                }
+                const uint32_t ratio100 = (den == 0) ? 0 :
+                    (uint32_t)((num * 100) / den);
+
+                (void)snprintf(cached, sizeof(cached), "x%5lu.%02lu",
+                    ratio100 / 100, ratio100 % 100);
+        } else if (test->cached) {
+                _test_value_format(cached, sizeof(cached), test,
+                    &results[i][CACHE_MODE_CACHED]);
+        } else {
+                (void)snprintf(cached, sizeof(cached), "%9s", "-");
         }
 
-        if (timer == TIMER_MAX_TIMERS_COUNT) {
-                ret = -1;
+        dbgio_printf("\n"
+                    "%-19s:%s %s\n",
+                     test->name,
+                     through,
+                     cached);
+}
 
-                goto exit;
-        }
+void
+main(void)
+{
+        dbgio_dev_default_init(DBGIO_DEV_VDP2_ASYNC);
+        dbgio_dev_font_load();
+        dbgio_dev_font_load_wait();
 
-        /* Point to next free timer */
-        _next_timer = timer;
+        _tests_generate();
 
-        timer_state->valid = false;
+        contention_init();
 
-        ret = 0;
+        timer_init(CPU_FRT_INTERRUPT_PRIORITY_LEVEL);
 
-exit:
-        cpu_intc_mask_set(i_mask);
+        report_init("memoryBenchmark");
 
-        return ret;
-}
+        testId = 0;
+        cacheMode = CACHE_MODE_THROUGH;
 
-static void
-_timer_handler(struct timer_event *event __unused)
-{
-  testing = false;
+        while(true) {
+          testsuite_t * const test = &tests[testId];
+          if ((testId == 0) && (cacheMode == CACHE_MODE_THROUGH)) {
+            report_pass_begin();
+          }
+          _test_prepare(test, cacheMode);
+          _test_measure(test, cacheMode);
+          if (test->finish != NULL) {
+            test->finish(test);
+          }
+          _test_report(test, cacheMode);
+          dbgio_puts("[1;1H[2J");
+          dbgio_puts("ns/op or MB/s      :  through    cached\n");
+          uint32_t start = (testId/10)*10;
+          uint32_t end = (testId/10)*10 + 10;
+          if (end > testCount) end = testCount;
+          for (uint32_t i=start; i< end; i++)
+          _test_print(&tests[i]);
+          _test_stats_print(test, cacheMode);
+          dbgio_flush();
+          if ((cacheMode == CACHE_MODE_THROUGH) && test->cached) {
+            cacheMode = CACHE_MODE_CACHED;
+          } else {
+            cacheMode = CACHE_MODE_THROUGH;
+            testId++;
+            testId %= testCount;
+          }
+          vdp_sync();
+        }
 }
 
-static void _timer_step_handler(struct timer_event *event __unused)
+void
+user_init(void)
 {
+        vdp2_tvmd_display_res_set(VDP2_TVMD_INTERLACE_NONE, VDP2_TVMD_HORZ_NORMAL_A,
+            VDP2_TVMD_VERT_224);
 
+        vdp2_scrn_back_screen_color_set(VDP2_VRAM_ADDR(3, 0x01FFFE),
+            COLOR_RGB1555(1, 0, 3, 3));
+
+        cpu_intc_mask_set(0);
+
+        vdp2_tvmd_display_set();
 }
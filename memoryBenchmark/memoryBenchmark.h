@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#ifndef MEMORY_BENCHMARK_H_
+#define MEMORY_BENCHMARK_H_
+
+#include <yaul.h>
+
+#define ACCESS_BYTE     (1 << 0)
+#define ACCESS_WORD     (1 << 1)
+#define ACCESS_LONG     (1 << 2)
+
+#define REGION_READ     (1 << 0)
+#define REGION_WRITE    (1 << 1)
+#define REGION_OPTIONAL (1 << 2) /* Only present when detected at boot */
+#define REGION_CACHED   (1 << 3) /* Also measured through the cached alias */
+#define REGION_WORK_RAM (1 << 4) /* Swept by the latency tests */
+#define REGION_BUS_A    (1 << 5)
+#define REGION_BUS_B    (1 << 6)
+#define REGION_NO_SCU_DMA (1 << 7) /* Not reachable by the SCU DMA */
+
+/* Clearing this bit of a cache-through address gives its cached alias */
+#define CACHE_THROUGH_BIT       (0x20000000)
+
+/* What the value returned by a test function counts */
+#define TEST_UNIT_ACCESS        0
+#define TEST_UNIT_BYTE          1
+#define TEST_UNIT_LOAD          2 /* Dependent loads, reported as latency */
+
+typedef struct {
+  char name[9];
+  char tag[4];    /* Short name used for region pairs */
+  uintptr_t addr; /* Cache-through address of the scratch window */
+  uint32_t size;  /* Size in bytes of the scratch window */
+  uint8_t widths;
+  uint8_t flags;
+} region_t;
+
+typedef struct testsuite testsuite_t;
+
+typedef uint32_t (*testFunc) (const testsuite_t *);
+typedef void (*testPrepareFunc) (const testsuite_t *);
+
+struct testsuite {
+  char name[20];
+  testFunc func;
+  testPrepareFunc prepare; /* Optional, called before each run */
+  testPrepareFunc finish; /* Optional, called after each run */
+  void *work; /* Private to the test's prepare and finish hooks */
+  const testsuite_t *baseline; /* When set, also report the slowdown */
+  uintptr_t addr; /* Alias measured by the current run */
+  uintptr_t through_addr;
+  uint32_t size; /* Bytes touched by one call, or working set size */
+  uint8_t unit;
+  bool cached; /* Also run through the cached alias */
+};
+
+/* Sink for the values loaded by the read kernels */
+extern uint32_t val32;
+
+extern uint32_t testBlockRead(const testsuite_t *test);
+extern uint32_t testBlockWrite(const testsuite_t *test);
+
+extern testsuite_t *test_alloc(const region_t *region, testFunc func,
+    uint8_t unit);
+
+extern void bandwidth_tests_generate(const region_t *region);
+extern void latency_tests_generate(const region_t *region);
+extern void contention_tests_generate(const region_t *regions, uint32_t count);
+extern void dma_tests_generate(const region_t *regions, uint32_t count);
+
+extern void contention_init(void);
+
+#endif /* !MEMORY_BENCHMARK_H_ */
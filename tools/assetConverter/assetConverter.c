@@ -0,0 +1,1171 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+/* Host side converter from a PNG sprite sheet to VDP1 textures
+ *
+ *   assetConverter [-c] [-f] [-j jobs] [-b 4|8|16] [-t rrggbb] [-x step]
+ *       [-y step] input.png count width height output
+ *
+ * Cuts count frames of width x height out of input.png, left to right then
+ * top to bottom, every step pixels (the frame size by default). The frames
+ * are written one after the other into <output>.TEX:
+ *
+ *   -b 4   4 bits per texel, the first texel in the upper nibble
+ *   -b 8   8 bits per texel (default)
+ *   -b 16  RGB1555 texels
+ *
+ * Palette textures share one palette over every frame, written into
+ * <output>.PAL as big endian RGB1555 entries. Frames with too many colors
+ * are quantised with a median cut. Code 0 is transparent, and so are the
+ * pixels of -t color and the pixels with an alpha below half.
+ *
+ * With -c, the frames are also compressed into <output>.CTX, laid out as
+ * described in common/ctex.h.
+ *
+ * Frames are converted by jobs threads, the number of processors by
+ * default. <output>.DEP records a hash of the input and of the options, and
+ * nothing is converted when it matches, unless -f is given. Outputs are
+ * only rewritten when their contents changed */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <png.h>
+
+/* Bumped whenever the output of a given input and options changes */
+#define CONVERTER_VERSION       (2)
+
+#define COLOR_COUNT             (32768)
+#define COLOR_TRANSPARENT       (0xFFFF)
+
+#define JOB_COUNT_MAX           (64)
+
+#define PATH_SIZE               (4096)
+
+/* Same as common/ctex.h, which needs libyaul */
+#define CTEX_MAGIC              (0x43545831UL)
+#define CTEX_LITERAL_MAX        (128)
+#define CTEX_RUN_MIN            (3)
+#define CTEX_RUN_MAX            (66)
+#define CTEX_DISTANCE_MAX       (65535)
+
+/* Positions searched for a match, most recent first */
+#define CTEX_CHAIN_MAX          (256)
+#define CTEX_HASH_COUNT         (4096)
+
+typedef struct {
+        uint32_t bpp;
+        uint32_t count;
+        uint32_t width;
+        uint32_t height;
+        uint32_t step_x;
+        uint32_t step_y;
+        uint32_t jobs;
+        bool transparent_set;
+        uint32_t transparent;
+        bool force;
+        bool compress;
+        const char *input;
+        const char *output;
+} options_t;
+
+typedef struct {
+        uint8_t *pixels;        /* RGBA */
+        uint32_t width;
+        uint32_t height;
+} image_t;
+
+/* Colors in use, with their pixel count and their first pixel, in the
+ * order of the frames */
+typedef struct {
+        uint32_t counts[COLOR_COUNT];
+        uint64_t firsts[COLOR_COUNT];
+} histogram_t;
+
+typedef struct {
+        const options_t *options;
+        const image_t *image;
+        uint16_t *frames;       /* RGB555, or COLOR_TRANSPARENT */
+        histogram_t *histograms;
+        uint16_t palette[256];
+        uint32_t palette_count;
+        uint8_t *map;           /* RGB555 to palette code */
+        uint8_t *texture;
+        size_t frame_size;      /* Bytes of one frame of texture */
+        uint8_t **compressed;
+        size_t *compressed_sizes;
+} conversion_t;
+
+typedef void (*job_t)(conversion_t *, uint32_t, uint32_t);
+
+typedef struct {
+        conversion_t *conversion;
+        job_t job;
+        uint32_t count;
+        uint32_t next;
+        pthread_mutex_t mutex;
+} jobs_t;
+
+typedef struct {
+        jobs_t *jobs;
+        uint32_t worker;
+} worker_t;
+
+static void _usage(void);
+static bool _options_parse(int, char **, options_t *);
+
+static uint8_t *_file_read(const char *, size_t *);
+static bool _file_update(const char *, const void *, size_t);
+
+static uint64_t _hash(uint64_t, const void *, size_t);
+static bool _stamp_check(const char *, uint64_t);
+
+static bool _image_read(const char *, image_t *);
+
+static void _jobs_run(conversion_t *, job_t, uint32_t, uint32_t);
+
+static void _frame_slice(conversion_t *, uint32_t, uint32_t);
+static void _frame_convert(conversion_t *, uint32_t, uint32_t);
+static void _frame_compress(conversion_t *, uint32_t, uint32_t);
+
+static void _palette_build(conversion_t *);
+
+static bool _ctex_write(const char *, const conversion_t *);
+
+int
+main(int argc, char *argv[])
+{
+        options_t options;
+
+        if (!_options_parse(argc, argv, &options)) {
+                _usage();
+
+                return 2;
+        }
+
+        char path_tex[PATH_SIZE];
+        char path_pal[PATH_SIZE];
+        char path_dep[PATH_SIZE];
+        char path_ctx[PATH_SIZE];
+
+        (void)snprintf(path_tex, sizeof(path_tex), "%s.TEX", options.output);
+        (void)snprintf(path_pal, sizeof(path_pal), "%s.PAL", options.output);
+        (void)snprintf(path_dep, sizeof(path_dep), "%s.DEP", options.output);
+        (void)snprintf(path_ctx, sizeof(path_ctx), "%s.CTX", options.output);
+
+        size_t input_size;
+        uint8_t * const input = _file_read(options.input, &input_size);
+
+        if (input == NULL) {
+                (void)fprintf(stderr, "assetConverter: %s: %s\n", options.input,
+                    strerror(errno));
+
+                return 1;
+        }
+
+        /* The hash covers every option that changes the outputs */
+        const uint32_t key[] = {
+                CONVERTER_VERSION,
+                options.bpp,
+                options.count,
+                options.width,
+                options.height,
+                options.step_x,
+                options.step_y,
+                options.transparent_set ? options.transparent : 0xFFFFFFFF,
+                options.compress
+        };
+
+        uint64_t hash;
+
+        hash = _hash(UINT64_C(0xCBF29CE484222325), key, sizeof(key));
+        hash = _hash(hash, input, input_size);
+
+        free(input);
+
+        if (!options.force && _stamp_check(path_dep, hash) &&
+            (access(path_tex, F_OK) == 0) &&
+            ((options.bpp == 16) || (access(path_pal, F_OK) == 0)) &&
+            (!options.compress || (access(path_ctx, F_OK) == 0))) {
+                return 0;
+        }
+
+        image_t image;
+
+        if (!_image_read(options.input, &image)) {
+                return 1;
+        }
+
+        const uint32_t per_row = ((image.width - options.width) / options.step_x) + 1;
+        const uint32_t last = options.count - 1;
+
+        if ((options.width > image.width) || (options.height > image.height) ||
+            ((((last % per_row) * options.step_x) + options.width) > image.width) ||
+            ((((last / per_row) * options.step_y) + options.height) > image.height)) {
+                (void)fprintf(stderr, "assetConverter: %s: %" PRIu32
+                    " frames of %" PRIu32 "x%" PRIu32 " do not fit in %" PRIu32
+                    "x%" PRIu32 "\n", options.input, options.count,
+                    options.width, options.height, image.width, image.height);
+
+                return 1;
+        }
+
+        conversion_t conversion;
+
+        (void)memset(&conversion, 0x00, sizeof(conversion));
+
+        const size_t frame_pixels = options.width * options.height;
+
+        conversion.options = &options;
+        conversion.image = &image;
+        conversion.frame_size = (frame_pixels * options.bpp) / 8;
+        conversion.frames = malloc(options.count * frame_pixels * sizeof(uint16_t));
+        conversion.histograms = calloc(options.jobs, sizeof(histogram_t));
+        conversion.map = malloc(COLOR_COUNT);
+        conversion.texture = malloc(options.count * conversion.frame_size);
+        conversion.compressed = calloc(options.count, sizeof(uint8_t *));
+        conversion.compressed_sizes = calloc(options.count, sizeof(size_t));
+
+        if ((conversion.frames == NULL) || (conversion.histograms == NULL) ||
+            (conversion.map == NULL) || (conversion.texture == NULL) ||
+            (conversion.compressed == NULL) || (conversion.compressed_sizes == NULL)) {
+                (void)fprintf(stderr, "assetConverter: Out of memory\n");
+
+                return 1;
+        }
+
+        _jobs_run(&conversion, _frame_slice, options.count, options.jobs);
+
+        if (options.bpp != 16) {
+                _palette_build(&conversion);
+        }
+
+        _jobs_run(&conversion, _frame_convert, options.count, options.jobs);
+
+        if (options.compress) {
+                _jobs_run(&conversion, _frame_compress, options.count, options.jobs);
+        }
+
+        bool written;
+
+        written = _file_update(path_tex, conversion.texture,
+            options.count * conversion.frame_size);
+
+        if (written && (options.bpp != 16)) {
+                uint8_t palette[256 * 2];
+                const uint32_t entries = 1 << options.bpp;
+
+                (void)memset(palette, 0x00, sizeof(palette));
+
+                for (uint32_t i = 0; i < conversion.palette_count; i++) {
+                        const uint16_t color = 0x8000 | conversion.palette[i];
+
+                        palette[(2 * i) + 0] = color >> 8;
+                        palette[(2 * i) + 1] = color & 0xFF;
+                }
+
+                written = _file_update(path_pal, palette, entries * 2);
+        }
+
+        if (written && options.compress) {
+                written = _ctex_write(path_ctx, &conversion);
+        }
+
+        if (written) {
+                char stamp[32];
+
+                (void)snprintf(stamp, sizeof(stamp), "%016" PRIx64 "\n", hash);
+
+                written = _file_update(path_dep, stamp, strlen(stamp));
+        }
+
+        for (uint32_t i = 0; i < options.count; i++) {
+                free(conversion.compressed[i]);
+        }
+
+        free(conversion.compressed_sizes);
+        free(conversion.compressed);
+        free(conversion.texture);
+        free(conversion.map);
+        free(conversion.histograms);
+        free(conversion.frames);
+        free(image.pixels);
+
+        return written ? 0 : 1;
+}
+
+static void
+_usage(void)
+{
+        (void)fprintf(stderr,
+            "usage: assetConverter [-c] [-f] [-j jobs] [-b 4|8|16] [-t rrggbb] "
+            "[-x step]\n"
+            "           [-y step] input.png count width height output\n");
+}
+
+static bool
+_number_parse(const char *string, uint32_t base, uint32_t *value)
+{
+        char *end;
+
+        errno = 0;
+
+        const unsigned long number = strtoul(string, &end, base);
+
+        if ((errno != 0) || (*string == '\0') || (*end != '\0') ||
+            (number > UINT32_MAX)) {
+                return false;
+        }
+
+        *value = number;
+
+        return true;
+}
+
+static bool
+_options_parse(int argc, char **argv, options_t *options)
+{
+        const long processors = sysconf(_SC_NPROCESSORS_ONLN);
+        int option;
+
+        (void)memset(options, 0x00, sizeof(*options));
+
+        options->bpp = 8;
+        options->jobs = (processors > 0) ? processors : 1;
+
+        while ((option = getopt(argc, argv, "cfj:b:t:x:y:")) != -1) {
+                switch (option) {
+                case 'c':
+                        options->compress = true;
+                        break;
+                case 'f':
+                        options->force = true;
+                        break;
+                case 'j':
+                        if (!_number_parse(optarg, 10, &options->jobs)) {
+                                return false;
+                        }
+                        break;
+                case 'b':
+                        if (!_number_parse(optarg, 10, &options->bpp)) {
+                                return false;
+                        }
+                        break;
+                case 't':
+                        if (!_number_parse(optarg, 16, &options->transparent) ||
+                            (options->transparent > 0xFFFFFF)) {
+                                return false;
+                        }
+                        options->transparent_set = true;
+                        break;
+                case 'x':
+                        if (!_number_parse(optarg, 10, &options->step_x)) {
+                                return false;
+                        }
+                        break;
+                case 'y':
+                        if (!_number_parse(optarg, 10, &options->step_y)) {
+                                return false;
+                        }
+                        break;
+                default:
+                        return false;
+                }
+        }
+
+        if ((argc - optind) != 5) {
+                return false;
+        }
+
+        options->input = argv[optind];
+        options->output = argv[optind + 4];
+
+        if (!_number_parse(argv[optind + 1], 10, &options->count) ||
+            !_number_parse(argv[optind + 2], 10, &options->width) ||
+            !_number_parse(argv[optind + 3], 10, &options->height)) {
+                return false;
+        }
+
+        if ((options->bpp != 4) && (options->bpp != 8) && (options->bpp != 16)) {
+                return false;
+        }
+
+        if ((options->count == 0) || (options->width == 0) ||
+            (options->height == 0)) {
+                return false;
+        }
+
+        /* VDP1 character widths are multiples of 8 texels */
+        if ((options->width & 7) != 0) {
+                (void)fprintf(stderr, "assetConverter: Width must be a multiple of 8\n");
+
+                return false;
+        }
+
+        if (options->step_x == 0) {
+                options->step_x = options->width;
+        }
+
+        if (options->step_y == 0) {
+                options->step_y = options->height;
+        }
+
+        if (options->jobs == 0) {
+                options->jobs = 1;
+        }
+
+        if (options->jobs > JOB_COUNT_MAX) {
+                options->jobs = JOB_COUNT_MAX;
+        }
+
+        if (options->jobs > options->count) {
+                options->jobs = options->count;
+        }
+
+        return true;
+}
+
+static uint8_t *
+_file_read(const char *path, size_t *size)
+{
+        FILE * const file = fopen(path, "rb");
+
+        if (file == NULL) {
+                return NULL;
+        }
+
+        uint8_t *buffer = NULL;
+        size_t capacity = 0;
+
+        *size = 0;
+
+        while (true) {
+                if (*size == capacity) {
+                        capacity = (capacity == 0) ? 65536 : (capacity * 2);
+
+                        uint8_t * const grown = realloc(buffer, capacity);
+
+                        if (grown == NULL) {
+                                free(buffer);
+                                (void)fclose(file);
+
+                                errno = ENOMEM;
+
+                                return NULL;
+                        }
+
+                        buffer = grown;
+                }
+
+                const size_t read = fread(&buffer[*size], 1, capacity - *size, file);
+
+                if (read == 0) {
+                        break;
+                }
+
+                *size += read;
+        }
+
+        const bool failed = ferror(file);
+
+        (void)fclose(file);
+
+        if (failed) {
+                free(buffer);
+
+                errno = EIO;
+
+                return NULL;
+        }
+
+        return buffer;
+}
+
+/* Leaves the file untouched when it already holds the same bytes, so that
+ * its modification time only moves when its contents do */
+static bool
+_file_update(const char *path, const void *buffer, size_t size)
+{
+        size_t old_size;
+        uint8_t * const old = _file_read(path, &old_size);
+
+        if (old != NULL) {
+                const bool same = (old_size == size) &&
+                    (memcmp(old, buffer, size) == 0);
+
+                free(old);
+
+                if (same) {
+                        return true;
+                }
+        }
+
+        FILE * const file = fopen(path, "wb");
+
+        if (file == NULL) {
+                (void)fprintf(stderr, "assetConverter: %s: %s\n", path,
+                    strerror(errno));
+
+                return false;
+        }
+
+        const bool written = (fwrite(buffer, 1, size, file) == size);
+
+        if ((fclose(file) != 0) || !written) {
+                (void)fprintf(stderr, "assetConverter: %s: Write error\n", path);
+
+                return false;
+        }
+
+        return true;
+}
+
+/* 64-bit FNV-1a */
+static uint64_t
+_hash(uint64_t hash, const void *buffer, size_t size)
+{
+        const uint8_t *bytes = buffer;
+
+        for (size_t i = 0; i < size; i++) {
+                hash ^= bytes[i];
+                hash *= UINT64_C(0x100000001B3);
+        }
+
+        return hash;
+}
+
+static bool
+_stamp_check(const char *path, uint64_t hash)
+{
+        FILE * const file = fopen(path, "r");
+
+        if (file == NULL) {
+                return false;
+        }
+
+        uint64_t stamp;
+
+        const bool read = (fscanf(file, "%" SCNx64, &stamp) == 1);
+
+        (void)fclose(file);
+
+        return read && (stamp == hash);
+}
+
+static bool
+_image_read(const char *path, image_t *image)
+{
+        png_image png;
+
+        (void)memset(&png, 0x00, sizeof(png));
+
+        png.version = PNG_IMAGE_VERSION;
+
+        if (png_image_begin_read_from_file(&png, path) == 0) {
+                (void)fprintf(stderr, "assetConverter: %s: %s\n", path,
+                    png.message);
+
+                return false;
+        }
+
+        png.format = PNG_FORMAT_RGBA;
+
+        image->width = png.width;
+        image->height = png.height;
+        image->pixels = malloc(PNG_IMAGE_SIZE(png));
+
+        if (image->pixels == NULL) {
+                png_image_free(&png);
+
+                (void)fprintf(stderr, "assetConverter: Out of memory\n");
+
+                return false;
+        }
+
+        if (png_image_finish_read(&png, NULL, image->pixels, 0, NULL) == 0) {
+                (void)fprintf(stderr, "assetConverter: %s: %s\n", path,
+                    png.message);
+
+                free(image->pixels);
+
+                return false;
+        }
+
+        return true;
+}
+
+static void *
+_worker(void *argument)
+{
+        worker_t * const worker = argument;
+        jobs_t * const jobs = worker->jobs;
+
+        while (true) {
+                (void)pthread_mutex_lock(&jobs->mutex);
+
+                const uint32_t index = jobs->next;
+
+                if (index < jobs->count) {
+                        jobs->next++;
+                }
+
+                (void)pthread_mutex_unlock(&jobs->mutex);
+
+                if (index >= jobs->count) {
+                        break;
+                }
+
+                jobs->job(jobs->conversion, worker->worker, index);
+        }
+
+        return NULL;
+}
+
+/* Runs job over every frame, each worker taking the next frame left */
+static void
+_jobs_run(conversion_t *conversion, job_t job, uint32_t count, uint32_t workers)
+{
+        pthread_t threads[JOB_COUNT_MAX];
+        worker_t worker_args[JOB_COUNT_MAX];
+        jobs_t jobs;
+
+        jobs.conversion = conversion;
+        jobs.job = job;
+        jobs.count = count;
+        jobs.next = 0;
+
+        (void)pthread_mutex_init(&jobs.mutex, NULL);
+
+        for (uint32_t i = 0; i < workers; i++) {
+                worker_args[i].jobs = &jobs;
+                worker_args[i].worker = i;
+        }
+
+        /* The calling thread is the first worker */
+        uint32_t started;
+
+        for (started = 1; started < workers; started++) {
+                if (pthread_create(&threads[started], NULL, _worker,
+                        &worker_args[started]) != 0) {
+                        break;
+                }
+        }
+
+        (void)_worker(&worker_args[0]);
+
+        for (uint32_t i = 1; i < started; i++) {
+                (void)pthread_join(threads[i], NULL);
+        }
+
+        (void)pthread_mutex_destroy(&jobs.mutex);
+}
+
+/* Cuts a frame out of the image into RGB555, and counts its colors in the
+ * histogram of the worker */
+static void
+_frame_slice(conversion_t *conversion, uint32_t worker, uint32_t frame)
+{
+        const options_t * const options = conversion->options;
+        const image_t * const image = conversion->image;
+        histogram_t * const histogram = &conversion->histograms[worker];
+
+        const uint32_t per_row = ((image->width - options->width) / options->step_x) + 1;
+        const uint32_t x0 = (frame % per_row) * options->step_x;
+        const uint32_t y0 = (frame / per_row) * options->step_y;
+
+        const size_t frame_pixels = options->width * options->height;
+        uint16_t * const pixels = &conversion->frames[frame * frame_pixels];
+
+        for (uint32_t y = 0; y < options->height; y++) {
+                const uint8_t *rgba = &image->pixels[
+                        (((y0 + y) * image->width) + x0) * 4];
+
+                for (uint32_t x = 0; x < options->width; x++, rgba += 4) {
+                        const uint32_t rgb = (rgba[0] << 16) | (rgba[1] << 8) | rgba[2];
+                        const uint32_t index = (y * options->width) + x;
+
+                        if ((rgba[3] < 128) ||
+                            (options->transparent_set && (rgb == options->transparent))) {
+                                pixels[index] = COLOR_TRANSPARENT;
+
+                                continue;
+                        }
+
+                        const uint16_t color =
+                            ((rgba[2] >> 3) << 10) | ((rgba[1] >> 3) << 5) | (rgba[0] >> 3);
+                        const uint64_t first = ((uint64_t)frame * frame_pixels) + index;
+
+                        pixels[index] = color;
+
+                        if ((histogram->counts[color] == 0) ||
+                            (first < histogram->firsts[color])) {
+                                histogram->firsts[color] = first;
+                        }
+
+                        histogram->counts[color]++;
+                }
+        }
+}
+
+typedef struct {
+        uint16_t color;
+        uint32_t count;
+        uint64_t first;
+} color_t;
+
+typedef struct {
+        uint32_t begin;
+        uint32_t end;
+        uint32_t axis;
+        uint32_t range;
+} box_t;
+
+static uint32_t
+_component_get(uint16_t color, uint32_t axis)
+{
+        return (color >> (axis * 5)) & 0x1F;
+}
+
+static int
+_first_compare(const void *a, const void *b)
+{
+        const color_t * const color_a = a;
+        const color_t * const color_b = b;
+
+        return (color_a->first > color_b->first) - (color_a->first < color_b->first);
+}
+
+static uint32_t _sort_axis;
+
+static int
+_component_compare(const void *a, const void *b)
+{
+        const uint32_t component_a = _component_get(((const color_t *)a)->color, _sort_axis);
+        const uint32_t component_b = _component_get(((const color_t *)b)->color, _sort_axis);
+
+        if (component_a != component_b) {
+                return (component_a > component_b) - (component_a < component_b);
+        }
+
+        return _first_compare(a, b);
+}
+
+/* Widest component of a box of colors */
+static void
+_box_measure(const color_t *colors, box_t *box)
+{
+        box->range = 0;
+        box->axis = 0;
+
+        for (uint32_t axis = 0; axis < 3; axis++) {
+                uint32_t low = 0x1F;
+                uint32_t high = 0;
+
+                for (uint32_t i = box->begin; i < box->end; i++) {
+                        const uint32_t component = _component_get(colors[i].color, axis);
+
+                        low = (component < low) ? component : low;
+                        high = (component > high) ? component : high;
+                }
+
+                if ((high - low) > box->range) {
+                        box->range = high - low;
+                        box->axis = axis;
+                }
+        }
+}
+
+/* Pixel weighted mean of a box of colors */
+static uint16_t
+_box_color_get(const color_t *colors, const box_t *box)
+{
+        uint64_t sums[3] = { 0, 0, 0 };
+        uint64_t count = 0;
+
+        for (uint32_t i = box->begin; i < box->end; i++) {
+                for (uint32_t axis = 0; axis < 3; axis++) {
+                        sums[axis] += (uint64_t)_component_get(colors[i].color, axis) *
+                            colors[i].count;
+                }
+
+                count += colors[i].count;
+        }
+
+        uint16_t color = 0;
+
+        for (uint32_t axis = 0; axis < 3; axis++) {
+                color |= ((sums[axis] + (count / 2)) / count) << (axis * 5);
+        }
+
+        return color;
+}
+
+/* Code 0 is transparent. Every color gets a code of its own when they fit,
+ * in the order they first appear in. Otherwise the colors are cut into as
+ * many boxes as there are codes, each box split at its pixel median along
+ * its widest component */
+static void
+_palette_build(conversion_t *conversion)
+{
+        const options_t * const options = conversion->options;
+        const uint32_t codes = (1 << options->bpp) - 1;
+
+        static color_t colors[COLOR_COUNT];
+        uint32_t color_count = 0;
+
+        for (uint32_t color = 0; color < COLOR_COUNT; color++) {
+                uint32_t count = 0;
+                uint64_t first = UINT64_MAX;
+
+                for (uint32_t worker = 0; worker < options->jobs; worker++) {
+                        const histogram_t * const histogram =
+                            &conversion->histograms[worker];
+
+                        if (histogram->counts[color] == 0) {
+                                continue;
+                        }
+
+                        count += histogram->counts[color];
+                        first = (histogram->firsts[color] < first) ?
+                            histogram->firsts[color] : first;
+                }
+
+                if (count != 0) {
+                        colors[color_count].color = color;
+                        colors[color_count].count = count;
+                        colors[color_count].first = first;
+                        color_count++;
+                }
+        }
+
+        conversion->palette[0] = 0x0000;
+        conversion->palette_count = 1;
+
+        (void)memset(conversion->map, 0x00, COLOR_COUNT);
+
+        if (color_count <= codes) {
+                qsort(colors, color_count, sizeof(color_t), _first_compare);
+
+                for (uint32_t i = 0; i < color_count; i++) {
+                        conversion->palette[conversion->palette_count] = colors[i].color;
+                        conversion->map[colors[i].color] = conversion->palette_count;
+                        conversion->palette_count++;
+                }
+
+                return;
+        }
+
+        box_t boxes[256];
+        uint32_t box_count = 1;
+
+        boxes[0].begin = 0;
+        boxes[0].end = color_count;
+        _box_measure(colors, &boxes[0]);
+
+        while (box_count < codes) {
+                uint32_t widest = 0;
+
+                for (uint32_t i = 1; i < box_count; i++) {
+                        if (boxes[i].range > boxes[widest].range) {
+                                widest = i;
+                        }
+                }
+
+                box_t * const box = &boxes[widest];
+
+                if (box->range == 0) {
+                        break;
+                }
+
+                _sort_axis = box->axis;
+
+                qsort(&colors[box->begin], box->end - box->begin, sizeof(color_t),
+                    _component_compare);
+
+                uint64_t total = 0;
+
+                for (uint32_t i = box->begin; i < box->end; i++) {
+                        total += colors[i].count;
+                }
+
+                uint64_t below = 0;
+                uint32_t split = box->begin + 1;
+
+                for (uint32_t i = box->begin; i < (box->end - 1); i++) {
+                        below += colors[i].count;
+                        split = i + 1;
+
+                        if ((below * 2) >= total) {
+                                break;
+                        }
+                }
+
+                boxes[box_count].begin = split;
+                boxes[box_count].end = box->end;
+                box->end = split;
+
+                _box_measure(colors, box);
+                _box_measure(colors, &boxes[box_count]);
+
+                box_count++;
+        }
+
+        for (uint32_t i = 0; i < box_count; i++) {
+                const uint16_t color = _box_color_get(colors, &boxes[i]);
+
+                conversion->palette[conversion->palette_count] = color;
+
+                for (uint32_t j = boxes[i].begin; j < boxes[i].end; j++) {
+                        conversion->map[colors[j].color] = conversion->palette_count;
+                }
+
+                conversion->palette_count++;
+        }
+}
+
+/* Writes a frame in the texture format. Palette codes come from the color
+ * map built over every frame */
+static void
+_frame_convert(conversion_t *conversion, uint32_t worker __attribute__((unused)),
+    uint32_t frame)
+{
+        const options_t * const options = conversion->options;
+
+        const size_t frame_pixels = options->width * options->height;
+        const uint16_t * const pixels = &conversion->frames[frame * frame_pixels];
+        uint8_t * const texels = &conversion->texture[frame * conversion->frame_size];
+
+        for (size_t i = 0; i < frame_pixels; i++) {
+                const uint16_t color = pixels[i];
+
+                switch (options->bpp) {
+                case 4: {
+                        const uint8_t code = (color == COLOR_TRANSPARENT) ? 0 :
+                            conversion->map[color];
+
+                        if ((i & 1) == 0) {
+                                texels[i / 2] = code << 4;
+                        } else {
+                                texels[i / 2] |= code;
+                        }
+                } break;
+                case 8:
+                        texels[i] = (color == COLOR_TRANSPARENT) ? 0 :
+                            conversion->map[color];
+                        break;
+                case 16: {
+                        const uint16_t texel = (color == COLOR_TRANSPARENT) ? 0x0000 :
+                            (0x8000 | color);
+
+                        texels[(2 * i) + 0] = texel >> 8;
+                        texels[(2 * i) + 1] = texel & 0xFF;
+                } break;
+                }
+        }
+}
+
+static void
+_literals_flush(uint8_t *out, size_t *size, const uint8_t *literals,
+    uint32_t *count)
+{
+        for (uint32_t i = 0; i < *count; i += CTEX_LITERAL_MAX) {
+                const uint32_t left = *count - i;
+                const uint32_t length = (left < CTEX_LITERAL_MAX) ? left : CTEX_LITERAL_MAX;
+
+                out[(*size)++] = length - 1;
+                (void)memcpy(&out[*size], &literals[i], length);
+                *size += length;
+        }
+
+        *count = 0;
+}
+
+static uint32_t
+_position_hash(const uint8_t *texels)
+{
+        const uint32_t key = (texels[0] << 16) | (texels[1] << 8) | texels[2];
+
+        return ((key * UINT32_C(2654435761)) >> 20) & (CTEX_HASH_COUNT - 1);
+}
+
+/* Greedy parse of a frame. At each position, the longest of a run of one
+ * byte and of a match found along the hash chain is taken when it saves
+ * bytes, otherwise the byte goes into the pending literals. A run costs 2
+ * bytes and a match 3, so a run wins a tie */
+static void
+_frame_compress(conversion_t *conversion, uint32_t worker __attribute__((unused)),
+    uint32_t frame)
+{
+        const size_t size = conversion->frame_size;
+        const uint8_t * const texels = &conversion->texture[frame * size];
+
+        /* Literals only, the worst case */
+        uint8_t * const out = malloc(size + (size / CTEX_LITERAL_MAX) + 1);
+        int32_t * const heads = malloc(CTEX_HASH_COUNT * sizeof(int32_t));
+        int32_t * const previous = malloc(size * sizeof(int32_t));
+
+        if ((out == NULL) || (heads == NULL) || (previous == NULL)) {
+                (void)fprintf(stderr, "assetConverter: Out of memory\n");
+
+                exit(1);
+        }
+
+        for (uint32_t i = 0; i < CTEX_HASH_COUNT; i++) {
+                heads[i] = -1;
+        }
+
+        size_t out_size = 0;
+        uint32_t literal_count = 0;
+        size_t literal_start = 0;
+        size_t position = 0;
+
+        while (position < size) {
+                const size_t left = size - position;
+                const size_t limit = (left < CTEX_RUN_MAX) ? left : CTEX_RUN_MAX;
+
+                size_t run = 1;
+
+                while ((run < limit) && (texels[position + run] == texels[position])) {
+                        run++;
+                }
+
+                size_t match = 0;
+                size_t distance = 0;
+
+                if (left >= CTEX_RUN_MIN) {
+                        int32_t candidate = heads[_position_hash(&texels[position])];
+
+                        for (uint32_t chain = 0;
+                             (candidate >= 0) && (chain < CTEX_CHAIN_MAX) &&
+                             ((position - candidate) <= CTEX_DISTANCE_MAX);
+                             chain++, candidate = previous[candidate]) {
+                                size_t length = 0;
+
+                                while ((length < limit) &&
+                                    (texels[candidate + length] == texels[position + length])) {
+                                        length++;
+                                }
+
+                                if (length > match) {
+                                        match = length;
+                                        distance = position - candidate;
+                                }
+
+                                if (match == limit) {
+                                        break;
+                                }
+                        }
+                }
+
+                size_t step;
+
+                if ((run >= CTEX_RUN_MIN) && (run >= match)) {
+                        _literals_flush(out, &out_size, &texels[literal_start], &literal_count);
+
+                        out[out_size++] = 0x80 | (run - CTEX_RUN_MIN);
+                        out[out_size++] = texels[position];
+
+                        step = run;
+                } else if (match > CTEX_RUN_MIN) {
+                        _literals_flush(out, &out_size, &texels[literal_start], &literal_count);
+
+                        out[out_size++] = 0xC0 | (match - CTEX_RUN_MIN);
+                        out[out_size++] = distance >> 8;
+                        out[out_size++] = distance & 0xFF;
+
+                        step = match;
+                } else {
+                        if (literal_count == 0) {
+                                literal_start = position;
+                        }
+
+                        literal_count++;
+
+                        step = 1;
+                }
+
+                /* Every position passed over can be matched later */
+                for (size_t i = 0; i < step; i++, position++) {
+                        if ((size - position) < CTEX_RUN_MIN) {
+                                continue;
+                        }
+
+                        const uint32_t hash = _position_hash(&texels[position]);
+
+                        previous[position] = heads[hash];
+                        heads[hash] = position;
+                }
+        }
+
+        _literals_flush(out, &out_size, &texels[literal_start], &literal_count);
+
+        free(previous);
+        free(heads);
+
+        conversion->compressed[frame] = out;
+        conversion->compressed_sizes[frame] = out_size;
+}
+
+static void
+_u32_put(uint8_t *bytes, uint32_t value)
+{
+        bytes[0] = value >> 24;
+        bytes[1] = (value >> 16) & 0xFF;
+        bytes[2] = (value >> 8) & 0xFF;
+        bytes[3] = value & 0xFF;
+}
+
+static bool
+_ctex_write(const char *path, const conversion_t *conversion)
+{
+        const uint32_t count = conversion->options->count;
+        const size_t header_size = (3 + count + 1) * sizeof(uint32_t);
+
+        size_t size = header_size;
+
+        for (uint32_t i = 0; i < count; i++) {
+                size += conversion->compressed_sizes[i];
+        }
+
+        uint8_t * const ctex = malloc(size);
+
+        if (ctex == NULL) {
+                (void)fprintf(stderr, "assetConverter: Out of memory\n");
+
+                return false;
+        }
+
+        _u32_put(&ctex[0], CTEX_MAGIC);
+        _u32_put(&ctex[4], count);
+        _u32_put(&ctex[8], conversion->frame_size);
+
+        size_t offset = header_size;
+
+        for (uint32_t i = 0; i < count; i++) {
+                _u32_put(&ctex[12 + (4 * i)], offset);
+
+                (void)memcpy(&ctex[offset], conversion->compressed[i],
+                    conversion->compressed_sizes[i]);
+
+                offset += conversion->compressed_sizes[i];
+        }
+
+        _u32_put(&ctex[12 + (4 * count)], offset);
+
+        const bool written = _file_update(path, ctex, size);
+
+        free(ctex);
+
+        return written;
+}
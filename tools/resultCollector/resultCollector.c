@@ -0,0 +1,496 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+/* Host side collector for the records streamed by common/report.c
+ *
+ *   resultCollector collect [-o dir] [-n passes] [input]
+ *     Reads records from input (a file or a device, stdin by default) and
+ *     writes every pass into <dir>/<program>-<date>-<pass>.csv
+ *
+ *   resultCollector diff [-t percent] baseline.csv run.csv
+ *     Compares the medians of two passes and exits with 1 when a result got
+ *     worse by more than percent (5 by default) and by more than the sum of
+ *     both standard deviations
+ *
+ * Records are captured from the USB dev cart, which the programs write to
+ * by default (see common/report.h). The host sees its FT245 as a serial
+ * device, /dev/ttyUSB0 on Linux:
+ *
+ *   1. Plug the cart into the Saturn, and its USB port into the host
+ *   2. stty -F /dev/ttyUSB0 raw -echo
+ *   3. resultCollector collect -o results -n 3 /dev/ttyUSB0
+ *   4. Boot the program, the collector already reading
+ *
+ * A pass is complete when the header of the next one arrives, so -n 3
+ * returns at the start of the fourth pass. Records sent before the device
+ * is opened are lost, so the collector has to be started first. A program
+ * whose cart stops taking bytes writes its records to its console instead */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LINE_SIZE               (512)
+#define FIELD_COUNT_MAX         (12)
+
+#define RECORD_FIELD_PROGRAM    1
+#define RECORD_FIELD_PASS       2
+#define RECORD_FIELD_NAME       3
+#define RECORD_FIELD_VARIANT    4
+#define RECORD_FIELD_UNIT       5
+#define RECORD_FIELD_MEDIAN     9
+#define RECORD_FIELD_STDDEV     11
+#define RECORD_FIELD_COUNT      12
+
+#define TIMELINE_FIELD_COUNT    8
+
+#define HEADER_FIELD_PROGRAM    1
+#define HEADER_FIELD_PASS       2
+#define HEADER_FIELD_COUNT      3
+
+typedef struct {
+        char *program;
+        char *pass;
+        char **lines;
+        size_t count;
+        size_t capacity;
+} pass_t;
+
+typedef struct {
+        char key[LINE_SIZE];
+        char unit[32];
+        double median;
+        double stddev;
+        bool matched;
+} result_t;
+
+typedef struct {
+        result_t *results;
+        size_t count;
+        size_t capacity;
+} results_t;
+
+static const char *_output_dir = ".";
+static char _session[32];
+
+static pass_t *_passes = NULL;
+static size_t _pass_count = 0;
+
+static void
+_usage(void)
+{
+        (void)fprintf(stderr,
+            "usage: resultCollector collect [-o dir] [-n passes] [input]\n"
+            "       resultCollector diff [-t percent] baseline.csv run.csv\n");
+
+        exit(2);
+}
+
+static void *
+_xrealloc(void *ptr, size_t size)
+{
+        void * const new_ptr = realloc(ptr, size);
+
+        if (new_ptr == NULL) {
+                (void)fprintf(stderr, "resultCollector: out of memory\n");
+
+                exit(2);
+        }
+
+        return new_ptr;
+}
+
+static char *
+_xstrdup(const char *s)
+{
+        char * const copy = _xrealloc(NULL, strlen(s) + 1);
+
+        (void)strcpy(copy, s);
+
+        return copy;
+}
+
+/* Splits a CSV line in place. Fields never contain commas */
+static size_t
+_fields_split(char *line, char **fields, size_t max)
+{
+        size_t count = 0;
+        char *p = line;
+
+        line[strcspn(line, "\r\n")] = '\0';
+
+        while (count < max) {
+                fields[count] = p;
+                count++;
+
+                p = strchr(p, ',');
+
+                if (p == NULL) {
+                        break;
+                }
+
+                *p = '\0';
+                p++;
+        }
+
+        return count;
+}
+
+static pass_t *
+_pass_find(const char *program)
+{
+        size_t i;
+
+        for (i = 0; i < _pass_count; i++) {
+                if (strcmp(_passes[i].program, program) == 0) {
+                        return &_passes[i];
+                }
+        }
+
+        _passes = _xrealloc(_passes, sizeof(pass_t) * (_pass_count + 1));
+
+        pass_t * const pass = &_passes[_pass_count];
+
+        _pass_count++;
+
+        (void)memset(pass, 0x00, sizeof(pass_t));
+
+        pass->program = _xstrdup(program);
+
+        return pass;
+}
+
+static void
+_pass_line_add(pass_t *pass, const char *line)
+{
+        if (pass->count == pass->capacity) {
+                pass->capacity = (pass->capacity == 0) ? 64 : (pass->capacity * 2);
+                pass->lines = _xrealloc(pass->lines, sizeof(char *) * pass->capacity);
+        }
+
+        pass->lines[pass->count] = _xstrdup(line);
+        pass->count++;
+}
+
+/* Returns true when a pass was written */
+static bool
+_pass_flush(pass_t *pass)
+{
+        size_t i;
+
+        if (pass->count == 0) {
+                return false;
+        }
+
+        char path[LINE_SIZE];
+
+        (void)snprintf(path, sizeof(path), "%s/%s-%s-%s.csv", _output_dir,
+            pass->program, _session, (pass->pass != NULL) ? pass->pass : "0");
+
+        FILE * const file = fopen(path, "w");
+
+        if (file == NULL) {
+                (void)fprintf(stderr, "resultCollector: %s: %s\n", path,
+                    strerror(errno));
+
+                exit(2);
+        }
+
+        for (i = 0; i < pass->count; i++) {
+                (void)fputs(pass->lines[i], file);
+                free(pass->lines[i]);
+        }
+
+        (void)fclose(file);
+
+        (void)printf("%s: %zu records\n", path, pass->count - 1);
+
+        pass->count = 0;
+
+        return true;
+}
+
+static int
+_collect(int argc, char *argv[])
+{
+        long passes_max = 0;
+        long passes = 0;
+        int opt;
+
+        while ((opt = getopt(argc, argv, "o:n:")) != -1) {
+                switch (opt) {
+                case 'o':
+                        _output_dir = optarg;
+                        break;
+                case 'n':
+                        passes_max = strtol(optarg, NULL, 10);
+                        break;
+                default:
+                        _usage();
+                }
+        }
+
+        FILE *input = stdin;
+
+        if (optind < argc) {
+                input = fopen(argv[optind], "r");
+
+                if (input == NULL) {
+                        (void)fprintf(stderr, "resultCollector: %s: %s\n",
+                            argv[optind], strerror(errno));
+
+                        return 2;
+                }
+        }
+
+        const time_t now = time(NULL);
+
+        (void)strftime(_session, sizeof(_session), "%Y%m%d-%H%M%S",
+            localtime(&now));
+
+        char line[LINE_SIZE];
+        char fields_line[LINE_SIZE];
+        char *fields[FIELD_COUNT_MAX];
+
+        while (fgets(line, sizeof(line), input) != NULL) {
+                /* Anything else on the stream is console output */
+                if ((line[0] == '\0') || (strchr("HRT", line[0]) == NULL) ||
+                    (line[1] != ',')) {
+                        continue;
+                }
+
+                (void)strcpy(fields_line, line);
+
+                const size_t count =
+                    _fields_split(fields_line, fields, FIELD_COUNT_MAX);
+
+                if ((line[0] == 'H') && (count == HEADER_FIELD_COUNT)) {
+                        pass_t * const pass = _pass_find(fields[HEADER_FIELD_PROGRAM]);
+
+                        if (_pass_flush(pass)) {
+                                passes++;
+                        }
+
+                        free(pass->pass);
+                        pass->pass = _xstrdup(fields[HEADER_FIELD_PASS]);
+
+                        _pass_line_add(pass, line);
+                } else if (((line[0] == 'R') && (count == RECORD_FIELD_COUNT)) ||
+                    ((line[0] == 'T') && (count == TIMELINE_FIELD_COUNT))) {
+                        pass_t * const pass = _pass_find(fields[RECORD_FIELD_PROGRAM]);
+
+                        /* Records before the first header are a partial pass */
+                        if (pass->count == 0) {
+                                continue;
+                        }
+
+                        _pass_line_add(pass, line);
+                }
+
+                if ((passes_max > 0) && (passes >= passes_max)) {
+                        break;
+                }
+        }
+
+        /* The pass in progress is only written when the stream ended */
+        if (feof(input)) {
+                size_t i;
+
+                for (i = 0; i < _pass_count; i++) {
+                        (void)_pass_flush(&_passes[i]);
+                }
+        }
+
+        if (input != stdin) {
+                (void)fclose(input);
+        }
+
+        return 0;
+}
+
+static void
+_results_load(const char *path, results_t *results)
+{
+        FILE * const file = fopen(path, "r");
+
+        if (file == NULL) {
+                (void)fprintf(stderr, "resultCollector: %s: %s\n", path,
+                    strerror(errno));
+
+                exit(2);
+        }
+
+        char line[LINE_SIZE];
+        char *fields[FIELD_COUNT_MAX];
+
+        while (fgets(line, sizeof(line), file) != NULL) {
+                if ((line[0] != 'R') || (line[1] != ',')) {
+                        continue;
+                }
+
+                if (_fields_split(line, fields, FIELD_COUNT_MAX) != RECORD_FIELD_COUNT) {
+                        continue;
+                }
+
+                if (results->count == results->capacity) {
+                        results->capacity = (results->capacity == 0) ? 64 :
+                            (results->capacity * 2);
+                        results->results = _xrealloc(results->results,
+                            sizeof(result_t) * results->capacity);
+                }
+
+                result_t * const result = &results->results[results->count];
+
+                results->count++;
+
+                (void)snprintf(result->key, sizeof(result->key), "%s,%s,%s",
+                    fields[RECORD_FIELD_PROGRAM], fields[RECORD_FIELD_NAME],
+                    fields[RECORD_FIELD_VARIANT]);
+                (void)snprintf(result->unit, sizeof(result->unit), "%s",
+                    fields[RECORD_FIELD_UNIT]);
+                result->median = strtod(fields[RECORD_FIELD_MEDIAN], NULL);
+                result->stddev = strtod(fields[RECORD_FIELD_STDDEV], NULL);
+                result->matched = false;
+        }
+
+        (void)fclose(file);
+}
+
+static result_t *
+_results_find(results_t *results, const char *key)
+{
+        size_t i;
+
+        for (i = 0; i < results->count; i++) {
+                if (strcmp(results->results[i].key, key) == 0) {
+                        return &results->results[i];
+                }
+        }
+
+        return NULL;
+}
+
+/* Rates such as kB/s or px/cycle get better as they grow, times as they
+ * shrink */
+static bool
+_unit_higher_is_better(const char *unit)
+{
+        return (strchr(unit, '/') != NULL);
+}
+
+static int
+_diff(int argc, char *argv[])
+{
+        double threshold = 5.0;
+        int opt;
+
+        while ((opt = getopt(argc, argv, "t:")) != -1) {
+                switch (opt) {
+                case 't':
+                        threshold = strtod(optarg, NULL);
+                        break;
+                default:
+                        _usage();
+                }
+        }
+
+        if ((argc - optind) != 2) {
+                _usage();
+        }
+
+        results_t baseline;
+        results_t run;
+
+        (void)memset(&baseline, 0x00, sizeof(baseline));
+        (void)memset(&run, 0x00, sizeof(run));
+
+        _results_load(argv[optind], &baseline);
+        _results_load(argv[optind + 1], &run);
+
+        size_t regressions = 0;
+        size_t improvements = 0;
+        size_t i;
+
+        for (i = 0; i < run.count; i++) {
+                result_t * const result = &run.results[i];
+                result_t * const base = _results_find(&baseline, result->key);
+
+                if (base == NULL) {
+                        (void)printf("new       %s: %.2f %s\n", result->key,
+                            result->median, result->unit);
+
+                        continue;
+                }
+
+                base->matched = true;
+
+                if (base->median == 0.0) {
+                        continue;
+                }
+
+                double change = ((result->median - base->median) * 100.0) / base->median;
+
+                if (_unit_higher_is_better(result->unit)) {
+                        change = -change;
+                }
+
+                const double delta = (result->median > base->median) ?
+                    (result->median - base->median) : (base->median - result->median);
+                const bool significant = (delta > (result->stddev + base->stddev));
+
+                const char *status = NULL;
+
+                if ((change > threshold) && significant) {
+                        status = "SLOWER   ";
+                        regressions++;
+                } else if ((change < -threshold) && significant) {
+                        status = "faster   ";
+                        improvements++;
+                }
+
+                if (status != NULL) {
+                        (void)printf("%s %s: %.2f -> %.2f %s (%+.1f%%)\n", status,
+                            result->key, base->median, result->median,
+                            result->unit, change);
+                }
+        }
+
+        for (i = 0; i < baseline.count; i++) {
+                if (!baseline.results[i].matched) {
+                        (void)printf("missing   %s\n", baseline.results[i].key);
+                }
+        }
+
+        (void)printf("%zu results, %zu slower, %zu faster\n", run.count,
+            regressions, improvements);
+
+        return (regressions > 0) ? 1 : 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+        if (argc < 2) {
+                _usage();
+        }
+
+        if (strcmp(argv[1], "collect") == 0) {
+                return _collect(argc - 1, &argv[1]);
+        }
+
+        if (strcmp(argv[1], "diff") == 0) {
+                return _diff(argc - 1, &argv[1]);
+        }
+
+        _usage();
+
+        return 2;
+}
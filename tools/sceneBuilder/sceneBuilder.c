@@ -0,0 +1,335 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+/* Host side builder of the primitive test scenes of Vdp1Drawing
+ *
+ *   sceneBuilder input.txt output.bin
+ *
+ * Each line of input.txt is a comment (#), or one case:
+ *
+ *   <type> <pmod> <colr> x0 y0 x1 y1 [x2 y2 x3 y3]
+ *
+ * or as many generated cases, with vertices spread over the cell:
+ *
+ *   random <type> <count> <seed> <pmod> <colr>
+ *
+ * Types are polygon, polyline, line and sprite, a distorted sprite whose
+ * colr is the zoom frame. Vertices are relative to the upper left corner
+ * of the cell the case is drawn in, from -128 to 127. Lines only use the
+ * first two. pmod is the raw CMDPMOD word.
+ *
+ * Consecutive cases of the same type, pmod and colr are written as one
+ * batch. The output is big endian:
+ *
+ *   'S' 'C' 'N' '1'
+ *   batch count (16-bit)
+ *   case count (16-bit)
+ *   batches:
+ *     type, case count (8-bit each)
+ *     pmod, colr (16-bit each)
+ *     cases: x0 y0 x1 y1 x2 y2 x3 y3 (8-bit each) */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LINE_SIZE               (512)
+#define FIELD_COUNT_MAX         (12)
+
+#define BATCH_CASE_COUNT_MAX    (255)
+#define CASE_COUNT_MAX          (65535)
+
+/* Generated vertices stay inside the cells of Vdp1Drawing */
+#define CELL_SIZE               (16)
+
+#define TYPE_POLYGON            0
+#define TYPE_POLYLINE           1
+#define TYPE_LINE               2
+#define TYPE_SPRITE             3
+#define TYPE_COUNT              4
+
+static const char * const _type_names[TYPE_COUNT] = {
+        "polygon",
+        "polyline",
+        "line",
+        "sprite"
+};
+
+typedef struct {
+        uint8_t type;
+        uint16_t pmod;
+        uint16_t colr;
+        int8_t vertices[8];
+} case_t;
+
+typedef struct {
+        uint8_t *bytes;
+        size_t size;
+        size_t capacity;
+
+        size_t batch;           /* Offset of the batch being filled */
+        bool batch_open;
+        uint16_t batch_count;
+        uint32_t case_count;
+
+        case_t last;
+} output_t;
+
+static void
+_usage(void)
+{
+        (void)fprintf(stderr, "usage: sceneBuilder input.txt output.bin\n");
+}
+
+static void
+_byte_put(output_t *output, uint8_t byte)
+{
+        if (output->size == output->capacity) {
+                output->capacity = (output->capacity == 0) ? 4096 : (output->capacity * 2);
+                output->bytes = realloc(output->bytes, output->capacity);
+
+                if (output->bytes == NULL) {
+                        (void)fprintf(stderr, "sceneBuilder: Out of memory\n");
+
+                        exit(1);
+                }
+        }
+
+        output->bytes[output->size++] = byte;
+}
+
+static void
+_u16_put(output_t *output, uint16_t value)
+{
+        _byte_put(output, value >> 8);
+        _byte_put(output, value & 0xFF);
+}
+
+static bool
+_case_put(output_t *output, const case_t *c)
+{
+        if (output->case_count == CASE_COUNT_MAX) {
+                return false;
+        }
+
+        const bool same = output->batch_open &&
+            (c->type == output->last.type) && (c->pmod == output->last.pmod) &&
+            (c->colr == output->last.colr) &&
+            (output->bytes[output->batch + 1] < BATCH_CASE_COUNT_MAX);
+
+        if (!same) {
+                output->batch = output->size;
+                output->batch_open = true;
+                output->batch_count++;
+
+                _byte_put(output, c->type);
+                _byte_put(output, 0);
+                _u16_put(output, c->pmod);
+                _u16_put(output, c->colr);
+        }
+
+        for (uint32_t i = 0; i < 8; i++) {
+                _byte_put(output, (uint8_t)c->vertices[i]);
+        }
+
+        output->bytes[output->batch + 1]++;
+        output->case_count++;
+        output->last = *c;
+
+        return true;
+}
+
+static bool
+_number_parse(const char *string, long min, long max, long *value)
+{
+        char *end;
+
+        errno = 0;
+
+        *value = strtol(string, &end, 0);
+
+        return (errno == 0) && (*string != '\0') && (*end == '\0') &&
+            (*value >= min) && (*value <= max);
+}
+
+static int
+_type_parse(const char *string)
+{
+        for (int type = 0; type < TYPE_COUNT; type++) {
+                if (strcmp(string, _type_names[type]) == 0) {
+                        return type;
+                }
+        }
+
+        return -1;
+}
+
+/* Same generator on every host, so that a seed always gives the same
+ * cases */
+static uint32_t
+_random_next(uint32_t *state)
+{
+        *state = (*state * UINT32_C(1103515245)) + UINT32_C(12345);
+
+        return (*state >> 16) & 0x7FFF;
+}
+
+static bool
+_line_parse(output_t *output, char **fields, uint32_t count)
+{
+        long values[FIELD_COUNT_MAX];
+        case_t c;
+
+        (void)memset(&c, 0x00, sizeof(c));
+
+        if (strcmp(fields[0], "random") == 0) {
+                if (count != 6) {
+                        return false;
+                }
+
+                const int type = _type_parse(fields[1]);
+
+                if ((type < 0) ||
+                    !_number_parse(fields[2], 1, CASE_COUNT_MAX, &values[0]) ||
+                    !_number_parse(fields[3], 0, UINT32_MAX, &values[1]) ||
+                    !_number_parse(fields[4], 0, 0xFFFF, &values[2]) ||
+                    !_number_parse(fields[5], 0, 0xFFFF, &values[3])) {
+                        return false;
+                }
+
+                uint32_t state = values[1];
+
+                c.type = type;
+                c.pmod = values[2];
+                c.colr = values[3];
+
+                for (long i = 0; i < values[0]; i++) {
+                        for (uint32_t v = 0; v < 8; v++) {
+                                c.vertices[v] = _random_next(&state) % CELL_SIZE;
+                        }
+
+                        if (!_case_put(output, &c)) {
+                                return false;
+                        }
+                }
+
+                return true;
+        }
+
+        const int type = _type_parse(fields[0]);
+        const uint32_t vertex_count = (type == TYPE_LINE) ? 2 : 4;
+
+        if ((type < 0) || ((count != (3 + (vertex_count * 2))) && (count != 11))) {
+                return false;
+        }
+
+        if (!_number_parse(fields[1], 0, 0xFFFF, &values[0]) ||
+            !_number_parse(fields[2], 0, 0xFFFF, &values[1])) {
+                return false;
+        }
+
+        c.type = type;
+        c.pmod = values[0];
+        c.colr = values[1];
+
+        for (uint32_t i = 3; i < count; i++) {
+                if (!_number_parse(fields[i], -128, 127, &values[0])) {
+                        return false;
+                }
+
+                c.vertices[i - 3] = values[0];
+        }
+
+        return _case_put(output, &c);
+}
+
+int
+main(int argc, char *argv[])
+{
+        if (argc != 3) {
+                _usage();
+
+                return 2;
+        }
+
+        FILE * const input = fopen(argv[1], "r");
+
+        if (input == NULL) {
+                (void)fprintf(stderr, "sceneBuilder: %s: %s\n", argv[1], strerror(errno));
+
+                return 1;
+        }
+
+        output_t output;
+        char line[LINE_SIZE];
+        uint32_t number = 0;
+
+        (void)memset(&output, 0x00, sizeof(output));
+
+        /* Header, counts filled in at the end */
+        _byte_put(&output, 'S');
+        _byte_put(&output, 'C');
+        _byte_put(&output, 'N');
+        _byte_put(&output, '1');
+        _u16_put(&output, 0);
+        _u16_put(&output, 0);
+
+        while (fgets(line, sizeof(line), input) != NULL) {
+                char *fields[FIELD_COUNT_MAX];
+                uint32_t count = 0;
+                char *save;
+
+                number++;
+
+                char * const comment = strchr(line, '#');
+
+                if (comment != NULL) {
+                        *comment = '\0';
+                }
+
+                for (char *field = strtok_r(line, " \t\r\n", &save);
+                     (field != NULL) && (count < FIELD_COUNT_MAX);
+                     field = strtok_r(NULL, " \t\r\n", &save)) {
+                        fields[count++] = field;
+                }
+
+                if (count == 0) {
+                        continue;
+                }
+
+                if (!_line_parse(&output, fields, count)) {
+                        (void)fprintf(stderr, "sceneBuilder: %s:%u: Invalid case\n",
+                            argv[1], number);
+
+                        return 1;
+                }
+        }
+
+        (void)fclose(input);
+
+        output.bytes[4] = output.batch_count >> 8;
+        output.bytes[5] = output.batch_count & 0xFF;
+        output.bytes[6] = output.case_count >> 8;
+        output.bytes[7] = output.case_count & 0xFF;
+
+        FILE * const file = fopen(argv[2], "wb");
+
+        if ((file == NULL) ||
+            (fwrite(output.bytes, 1, output.size, file) != output.size) ||
+            (fclose(file) != 0)) {
+                (void)fprintf(stderr, "sceneBuilder: %s: Write error\n", argv[2]);
+
+                return 1;
+        }
+
+        free(output.bytes);
+
+        return 0;
+}
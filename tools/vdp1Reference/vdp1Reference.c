@@ -0,0 +1,337 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+/* Host side front end of the reference VDP1 rasterizer
+ *
+ *   vdp1Reference render [-8] [-e color] width height vram.bin output.bin
+ *     Draws the command list of a 512 KB VDP1 VRAM dump into a framebuffer
+ *     of width x height, erased to color (0 by default), and writes it big
+ *     endian into output.bin
+ *
+ *   vdp1Reference check [-8] [-e color] width height vram.bin capture.bin...
+ *     Draws each VRAM dump and compares it against the framebuffer captured
+ *     from hardware or an emulator that follows it. Reports the cases that
+ *     differ and how many cases were checked per second, and exits with 1
+ *     when any differs
+ *
+ * With -8, the framebuffer has 8 bits per pixel */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "vdp1ref.h"
+
+/* Differing pixels listed per case */
+#define CHECK_PIXELS_MAX        (8)
+
+typedef struct {
+        uint16_t width;
+        uint16_t height;
+        uint8_t bpp;
+        uint16_t erase;
+} options_t;
+
+static void _usage(void);
+
+static bool
+_number_parse(const char *string, unsigned long max, unsigned long *value)
+{
+        char *end;
+
+        errno = 0;
+
+        *value = strtoul(string, &end, 0);
+
+        return (errno == 0) && (*string != '\0') && (*end == '\0') &&
+            (*value <= max);
+}
+
+/* Parses the options and the framebuffer size. Returns the index of the
+ * first file, or -1 */
+static int
+_options_parse(int argc, char **argv, options_t *options)
+{
+        unsigned long value;
+        int option;
+
+        options->bpp = 16;
+        options->erase = 0x0000;
+
+        while ((option = getopt(argc, argv, "8e:")) != -1) {
+                switch (option) {
+                case '8':
+                        options->bpp = 8;
+                        break;
+                case 'e':
+                        if (!_number_parse(optarg, 0xFFFF, &value)) {
+                                return -1;
+                        }
+
+                        options->erase = value;
+                        break;
+                default:
+                        return -1;
+                }
+        }
+
+        if ((argc - optind) < 2) {
+                return -1;
+        }
+
+        if (!_number_parse(argv[optind], 1024, &value) || (value == 0)) {
+                return -1;
+        }
+
+        options->width = value;
+
+        if (!_number_parse(argv[optind + 1], 512, &value) || (value == 0)) {
+                return -1;
+        }
+
+        options->height = value;
+
+        return optind + 2;
+}
+
+static bool
+_file_read(const char *path, void *buffer, size_t size)
+{
+        FILE * const file = fopen(path, "rb");
+
+        if (file == NULL) {
+                (void)fprintf(stderr, "vdp1Reference: %s: %s\n", path, strerror(errno));
+
+                return false;
+        }
+
+        const size_t read = fread(buffer, 1, size, file);
+
+        (void)fclose(file);
+
+        if (read != size) {
+                (void)fprintf(stderr, "vdp1Reference: %s: Expected %zu bytes\n",
+                    path, size);
+
+                return false;
+        }
+
+        return true;
+}
+
+static void
+_framebuffer_render(const options_t *options, const uint8_t *vram,
+    vdp1ref_framebuffer_t *framebuffer)
+{
+        framebuffer->width = options->width;
+        framebuffer->height = options->height;
+        framebuffer->bpp = options->bpp;
+
+        vdp1ref_framebuffer_erase(framebuffer, options->erase);
+        vdp1ref_render(vram, framebuffer, NULL);
+}
+
+/* Pixel of the framebuffer as stored on the Saturn */
+static uint16_t
+_pixel_get(const vdp1ref_framebuffer_t *framebuffer, uint32_t index)
+{
+        if (framebuffer->bpp == 8) {
+                return ((const uint8_t *)framebuffer->pixels)[index];
+        }
+
+        return ((const uint16_t *)framebuffer->pixels)[index];
+}
+
+static uint16_t
+_capture_get(const uint8_t *capture, uint8_t bpp, uint32_t index)
+{
+        if (bpp == 8) {
+                return capture[index];
+        }
+
+        return (capture[2 * index] << 8) | capture[(2 * index) + 1];
+}
+
+static int
+_render(int argc, char **argv)
+{
+        options_t options;
+        const int first = _options_parse(argc, argv, &options);
+
+        if ((first < 0) || ((argc - first) != 2)) {
+                _usage();
+
+                return 2;
+        }
+
+        const size_t count = options.width * options.height;
+        const size_t size = count * (options.bpp / 8);
+
+        uint8_t * const vram = malloc(VDP1REF_VRAM_SIZE);
+        uint8_t * const output = malloc(size);
+        vdp1ref_framebuffer_t framebuffer;
+
+        framebuffer.pixels = malloc(count * sizeof(uint16_t));
+
+        if ((vram == NULL) || (output == NULL) || (framebuffer.pixels == NULL)) {
+                (void)fprintf(stderr, "vdp1Reference: Out of memory\n");
+
+                return 1;
+        }
+
+        if (!_file_read(argv[first], vram, VDP1REF_VRAM_SIZE)) {
+                return 1;
+        }
+
+        _framebuffer_render(&options, vram, &framebuffer);
+
+        for (size_t i = 0; i < count; i++) {
+                const uint16_t pixel = _pixel_get(&framebuffer, i);
+
+                if (options.bpp == 8) {
+                        output[i] = pixel;
+                } else {
+                        output[(2 * i) + 0] = pixel >> 8;
+                        output[(2 * i) + 1] = pixel & 0xFF;
+                }
+        }
+
+        FILE * const file = fopen(argv[first + 1], "wb");
+
+        if ((file == NULL) || (fwrite(output, 1, size, file) != size) ||
+            (fclose(file) != 0)) {
+                (void)fprintf(stderr, "vdp1Reference: %s: Write error\n",
+                    argv[first + 1]);
+
+                return 1;
+        }
+
+        free(framebuffer.pixels);
+        free(output);
+        free(vram);
+
+        return 0;
+}
+
+static int
+_check(int argc, char **argv)
+{
+        options_t options;
+        const int first = _options_parse(argc, argv, &options);
+
+        if ((first < 0) || ((argc - first) < 2) || (((argc - first) % 2) != 0)) {
+                _usage();
+
+                return 2;
+        }
+
+        const size_t count = options.width * options.height;
+        const size_t size = count * (options.bpp / 8);
+
+        uint8_t * const vram = malloc(VDP1REF_VRAM_SIZE);
+        uint8_t * const capture = malloc(size);
+        vdp1ref_framebuffer_t framebuffer;
+
+        framebuffer.pixels = malloc(count * sizeof(uint16_t));
+
+        if ((vram == NULL) || (capture == NULL) || (framebuffer.pixels == NULL)) {
+                (void)fprintf(stderr, "vdp1Reference: Out of memory\n");
+
+                return 1;
+        }
+
+        uint32_t cases = 0;
+        uint32_t failures = 0;
+        double seconds = 0.0;
+
+        for (int i = first; i < argc; i += 2) {
+                if (!_file_read(argv[i], vram, VDP1REF_VRAM_SIZE) ||
+                    !_file_read(argv[i + 1], capture, size)) {
+                        return 1;
+                }
+
+                struct timespec start;
+                struct timespec end;
+
+                (void)clock_gettime(CLOCK_MONOTONIC, &start);
+                _framebuffer_render(&options, vram, &framebuffer);
+                (void)clock_gettime(CLOCK_MONOTONIC, &end);
+
+                seconds += (double)(end.tv_sec - start.tv_sec) +
+                    ((double)(end.tv_nsec - start.tv_nsec) / 1e9);
+
+                uint32_t differing = 0;
+
+                for (size_t p = 0; p < count; p++) {
+                        const uint16_t expected = _capture_get(capture, options.bpp, p);
+                        const uint16_t pixel = _pixel_get(&framebuffer, p);
+
+                        if (pixel == expected) {
+                                continue;
+                        }
+
+                        if (differing < CHECK_PIXELS_MAX) {
+                                (void)printf("%s: %zu,%zu: 0x%04X, expected 0x%04X\n",
+                                    argv[i], p % options.width, p / options.width,
+                                    pixel, expected);
+                        }
+
+                        differing++;
+                }
+
+                if (differing != 0) {
+                        (void)printf("%s: %u pixels differ\n", argv[i], differing);
+
+                        failures++;
+                }
+
+                cases++;
+        }
+
+        (void)printf("%u cases, %u differ, %.0f cases/s\n", cases, failures,
+            (seconds > 0.0) ? (cases / seconds) : 0.0);
+
+        free(framebuffer.pixels);
+        free(capture);
+        free(vram);
+
+        return (failures != 0) ? 1 : 0;
+}
+
+static void
+_usage(void)
+{
+        (void)fprintf(stderr,
+            "usage: vdp1Reference render [-8] [-e color] width height vram.bin output.bin\n"
+            "       vdp1Reference check [-8] [-e color] width height vram.bin capture.bin...\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+        if (argc < 2) {
+                _usage();
+
+                return 2;
+        }
+
+        if (strcmp(argv[1], "render") == 0) {
+                return _render(argc - 1, &argv[1]);
+        }
+
+        if (strcmp(argv[1], "check") == 0) {
+                return _check(argc - 1, &argv[1]);
+        }
+
+        _usage();
+
+        return 2;
+}
@@ -0,0 +1,1145 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#include <string.h>
+
+#include "vdp1ref.h"
+
+#define CMDT_SIZE               (32)
+
+#define CTRL_END                (1 << 15)
+#define CTRL_JUMP_SKIP          (1 << 14)
+#define CTRL_JUMP(ctrl)         (((ctrl) >> 12) & 3)
+#define CTRL_ZOOM_POINT(ctrl)   (((ctrl) >> 8) & 15)
+#define CTRL_FLIP_V             (1 << 5)
+#define CTRL_FLIP_H             (1 << 4)
+#define CTRL_COMMAND(ctrl)      ((ctrl) & 15)
+
+#define JUMP_NEXT               0
+#define JUMP_ASSIGN             1
+#define JUMP_CALL               2
+#define JUMP_RETURN             3
+
+#define COMMAND_NORMAL_SPRITE   0x0
+#define COMMAND_SCALED_SPRITE   0x1
+#define COMMAND_DISTORTED_SPRITE 0x2
+#define COMMAND_DISTORTED_SPRITE_ALT 0x3
+#define COMMAND_POLYGON         0x4
+#define COMMAND_POLYLINE        0x5
+#define COMMAND_LINE            0x6
+#define COMMAND_POLYLINE_ALT    0x7
+#define COMMAND_USER_CLIP       0x8
+#define COMMAND_SYSTEM_CLIP     0x9
+#define COMMAND_LOCAL_COORD     0xA
+#define COMMAND_USER_CLIP_ALT   0xB
+
+#define PMOD_MSB_ON             (1 << 15)
+#define PMOD_USER_CLIP_ENABLE   (1 << 10)
+#define PMOD_USER_CLIP_OUTSIDE  (1 << 9)
+#define PMOD_MESH               (1 << 8)
+#define PMOD_END_CODE_DISABLE   (1 << 7)
+#define PMOD_TRANS_PIXEL_DISABLE (1 << 6)
+#define PMOD_COLOR_MODE(pmod)   (((pmod) >> 3) & 7)
+#define PMOD_CC_MODE(pmod)      ((pmod) & 7)
+
+#define CC_REPLACE              0
+#define CC_SHADOW               1
+#define CC_HALF_LUMINANCE       2
+#define CC_HALF_TRANSPARENT     3
+#define CC_GOURAUD              4
+#define CC_GOURAUD_HALF_LUMINANCE 6
+#define CC_GOURAUD_HALF_TRANSPARENT 7
+
+/* Pixels of a span, the widest framebuffer */
+#define SPAN_COUNT_MAX          (1024)
+
+typedef struct {
+        const uint8_t *vram;
+        vdp1ref_framebuffer_t *framebuffer;
+        vdp1ref_stats_t *stats;
+
+        int32_t local_x;
+        int32_t local_y;
+        int32_t system_x;       /* Lower right corner, upper left is 0,0 */
+        int32_t system_y;
+        int32_t user_x0;
+        int32_t user_y0;
+        int32_t user_x1;
+        int32_t user_y1;
+} state_t;
+
+typedef struct {
+        int32_t x;
+        int32_t y;
+} point_t;
+
+/* Integer DDA, as the VDP1 steps edges, texels and gouraud channels: the
+ * whole part of the slope at every step, plus one more whenever the error
+ * term overflows. Both ends are exact */
+typedef struct {
+        int32_t value;
+        int32_t inc;
+        int32_t sign;
+        int32_t error;
+        int32_t error_inc;
+        int32_t error_adj;
+} stepper_t;
+
+/* RGB555 channels of a gouraud color, 0 to 31 */
+typedef struct {
+        int32_t c[3];
+} gouraud_t;
+
+typedef struct {
+        stepper_t c[3];
+} gouraud_stepper_t;
+
+typedef struct {
+        state_t *state;
+
+        uint16_t ctrl;
+        uint16_t pmod;
+        uint16_t colr;
+
+        bool textured;
+        uint32_t char_base;
+        uint32_t width;
+        uint32_t height;
+
+        bool gouraud;
+        gouraud_t gouraud_colors[4];
+} draw_t;
+
+/* One texture row, or none, drawn along a line */
+typedef struct {
+        uint32_t v;
+        uint32_t end_codes;
+        uint32_t last_u;
+} row_t;
+
+static inline uint16_t
+_vram_u16_get(const uint8_t *vram, uint32_t address)
+{
+        address &= VDP1REF_VRAM_SIZE - 1;
+
+        return (vram[address] << 8) | vram[(address + 1) & (VDP1REF_VRAM_SIZE - 1)];
+}
+
+static inline uint8_t
+_vram_u8_get(const uint8_t *vram, uint32_t address)
+{
+        return vram[address & (VDP1REF_VRAM_SIZE - 1)];
+}
+
+/* Vertices are 13-bit signed */
+static inline int32_t
+_coord_get(uint16_t raw)
+{
+        return ((int32_t)((uint32_t)raw << 19)) >> 19;
+}
+
+static inline int32_t
+_abs(int32_t value)
+{
+        return (value < 0) ? -value : value;
+}
+
+static inline int32_t
+_sign(int32_t value)
+{
+        return (value < 0) ? -1 : 1;
+}
+
+static inline int32_t
+_max(int32_t a, int32_t b)
+{
+        return (a > b) ? a : b;
+}
+
+static inline int32_t
+_min(int32_t a, int32_t b)
+{
+        return (a < b) ? a : b;
+}
+
+/* Halves each channel, keeping the MSB */
+static inline uint16_t
+_half(uint16_t color)
+{
+        return (color & 0x8000) | ((color >> 1) & 0x3DEF);
+}
+
+/* Mean of each channel */
+static inline uint16_t
+_average(uint16_t a, uint16_t b)
+{
+        const uint16_t rgb_a = a & 0x7FFF;
+        const uint16_t rgb_b = b & 0x7FFF;
+
+        return 0x8000 | ((rgb_a + rgb_b - ((rgb_a ^ rgb_b) & 0x0421)) >> 1);
+}
+
+/* A gouraud channel of 16 leaves the channel as is */
+static inline uint16_t
+_gouraud_channel_apply(uint16_t color, uint32_t shift, int32_t gouraud)
+{
+        const int32_t channel = ((color >> shift) & 0x1F) + gouraud - 16;
+
+        return ((channel < 0) ? 0 : ((channel > 31) ? 31 : channel)) << shift;
+}
+
+static inline uint16_t
+_gouraud_apply(uint16_t color, const gouraud_t *gouraud)
+{
+        return (color & 0x8000) |
+            _gouraud_channel_apply(color, 0, gouraud->c[0]) |
+            _gouraud_channel_apply(color, 5, gouraud->c[1]) |
+            _gouraud_channel_apply(color, 10, gouraud->c[2]);
+}
+
+static void
+_gouraud_get(uint16_t color, gouraud_t *gouraud)
+{
+        for (uint32_t i = 0; i < 3; i++) {
+                gouraud->c[i] = (color >> (i * 5)) & 0x1F;
+        }
+}
+
+/* Rounded to the nearest value at every step, halves away from start */
+static inline void
+_stepper_init(stepper_t *stepper, int32_t start, int32_t end, int32_t steps)
+{
+        const int32_t delta = end - start;
+
+        stepper->value = start;
+
+        if (steps == 0) {
+                stepper->inc = 0;
+                stepper->sign = 0;
+                stepper->error = -1;
+                stepper->error_inc = 0;
+                stepper->error_adj = 0;
+
+                return;
+        }
+
+        stepper->inc = delta / steps;
+        stepper->sign = _sign(delta);
+        stepper->error = -steps;
+        stepper->error_inc = 2 * _abs(delta % steps);
+        stepper->error_adj = 2 * steps;
+}
+
+static inline void
+_stepper_step(stepper_t *stepper)
+{
+        stepper->value += stepper->inc;
+        stepper->error += stepper->error_inc;
+
+        if (stepper->error >= 0) {
+                stepper->error -= stepper->error_adj;
+                stepper->value += stepper->sign;
+        }
+}
+
+static inline void
+_gouraud_stepper_init(gouraud_stepper_t *stepper, const gouraud_t *a,
+    const gouraud_t *b, int32_t steps)
+{
+        for (uint32_t i = 0; i < 3; i++) {
+                _stepper_init(&stepper->c[i], a->c[i], b->c[i], steps);
+        }
+}
+
+static inline void
+_gouraud_stepper_step(gouraud_stepper_t *stepper)
+{
+        for (uint32_t i = 0; i < 3; i++) {
+                _stepper_step(&stepper->c[i]);
+        }
+}
+
+static inline void
+_gouraud_stepper_get(const gouraud_stepper_t *stepper, gouraud_t *gouraud)
+{
+        for (uint32_t i = 0; i < 3; i++) {
+                gouraud->c[i] = stepper->c[i].value;
+        }
+}
+
+static inline bool
+_clipped(const draw_t *draw, int32_t x, int32_t y)
+{
+        const state_t * const state = draw->state;
+
+        if ((x < 0) || (y < 0) || (x > state->system_x) || (y > state->system_y) ||
+            (x >= state->framebuffer->width) || (y >= state->framebuffer->height)) {
+                return true;
+        }
+
+        if ((draw->pmod & PMOD_USER_CLIP_ENABLE) != 0) {
+                const bool inside =
+                    (x >= state->user_x0) && (x <= state->user_x1) &&
+                    (y >= state->user_y0) && (y <= state->user_y1);
+
+                return ((draw->pmod & PMOD_USER_CLIP_OUTSIDE) != 0) ? inside : !inside;
+        }
+
+        return false;
+}
+
+static void
+_pixel_plot(const draw_t *draw, int32_t x, int32_t y, uint16_t color,
+    const gouraud_t *gouraud)
+{
+        if (_clipped(draw, x, y)) {
+                return;
+        }
+
+        if (((draw->pmod & PMOD_MESH) != 0) && (((x ^ y) & 1) != 0)) {
+                return;
+        }
+
+        state_t * const state = draw->state;
+        vdp1ref_framebuffer_t * const framebuffer = state->framebuffer;
+        const uint32_t offset = (y * framebuffer->width) + x;
+
+        state->stats->pixels++;
+
+        /* Color calculation does not apply to 8 bpp framebuffers */
+        if (framebuffer->bpp == 8) {
+                ((uint8_t *)framebuffer->pixels)[offset] = color & 0xFF;
+
+                return;
+        }
+
+        uint16_t * const pixel = &((uint16_t *)framebuffer->pixels)[offset];
+        const uint16_t dst = *pixel;
+
+        if ((draw->pmod & PMOD_MSB_ON) != 0) {
+                *pixel = dst | 0x8000;
+
+                return;
+        }
+
+        switch (PMOD_CC_MODE(draw->pmod)) {
+        case CC_SHADOW:
+                if ((dst & 0x8000) != 0) {
+                        *pixel = _half(dst);
+                }
+                break;
+        case CC_HALF_LUMINANCE:
+                *pixel = _half(color);
+                break;
+        case CC_HALF_TRANSPARENT:
+                *pixel = ((dst & 0x8000) != 0) ? _average(color, dst) : color;
+                break;
+        case CC_GOURAUD:
+                *pixel = _gouraud_apply(color, gouraud);
+                break;
+        case CC_GOURAUD_HALF_LUMINANCE:
+                *pixel = _half(_gouraud_apply(color, gouraud));
+                break;
+        case CC_GOURAUD_HALF_TRANSPARENT:
+                color = _gouraud_apply(color, gouraud);
+                *pixel = ((dst & 0x8000) != 0) ? _average(color, dst) : color;
+                break;
+        default:
+                *pixel = color;
+                break;
+        }
+}
+
+/* Returns false when the texel is not drawn. An end code is never drawn,
+ * and the second one of a row ends it */
+static bool
+_texel_get(const draw_t *draw, row_t *row, uint32_t u, uint16_t *color,
+    bool *row_end)
+{
+        const uint8_t * const vram = draw->state->vram;
+        const uint32_t texel = (row->v * draw->width) + u;
+        const uint32_t mode = PMOD_COLOR_MODE(draw->pmod);
+
+        uint32_t code;
+        uint32_t end_code;
+
+        switch (mode) {
+        case 0:
+        case 1:
+                code = _vram_u8_get(vram, draw->char_base + (texel >> 1));
+                code = ((texel & 1) == 0) ? (code >> 4) : (code & 0x0F);
+                end_code = 0x0F;
+                break;
+        case 5:
+                code = _vram_u16_get(vram, draw->char_base + (texel << 1));
+                end_code = 0x7FFF;
+                break;
+        default:
+                code = _vram_u8_get(vram, draw->char_base + texel);
+                end_code = 0xFF;
+                break;
+        }
+
+        if (((draw->pmod & PMOD_END_CODE_DISABLE) == 0) && (code == end_code)) {
+                /* A magnified texel is only counted once */
+                if (u != row->last_u) {
+                        row->end_codes++;
+                }
+
+                row->last_u = u;
+                *row_end = (row->end_codes >= 2);
+
+                return false;
+        }
+
+        row->last_u = u;
+
+        if (((draw->pmod & PMOD_TRANS_PIXEL_DISABLE) == 0) && (code == 0)) {
+                return false;
+        }
+
+        switch (mode) {
+        case 0:
+                *color = (draw->colr & 0xFFF0) | code;
+                break;
+        case 1:
+                *color = _vram_u16_get(vram, ((uint32_t)draw->colr << 3) + (code << 1));
+                break;
+        case 2:
+                *color = (draw->colr & 0xFFC0) | (code & 0x3F);
+                break;
+        case 3:
+                *color = (draw->colr & 0xFF80) | (code & 0x7F);
+                break;
+        case 4:
+                *color = (draw->colr & 0xFF00) | code;
+                break;
+        default:
+                *color = code;
+                break;
+        }
+
+        return true;
+}
+
+/* Untextured lines of one color in replace mode, left to right, are plain
+ * fills. This loop is written so that compilers vectorize it */
+static bool
+_span_fill(const draw_t *draw, int32_t x0, int32_t x1, int32_t y)
+{
+        state_t * const state = draw->state;
+        vdp1ref_framebuffer_t * const framebuffer = state->framebuffer;
+
+        if ((draw->pmod & (PMOD_MSB_ON | PMOD_USER_CLIP_ENABLE | PMOD_MESH)) != 0) {
+                return false;
+        }
+
+        if ((PMOD_CC_MODE(draw->pmod) != CC_REPLACE) || draw->textured) {
+                return false;
+        }
+
+        if (x0 > x1) {
+                const int32_t x = x0;
+
+                x0 = x1;
+                x1 = x;
+        }
+
+        if ((y < 0) || (y > state->system_y) || (y >= framebuffer->height)) {
+                return true;
+        }
+
+        x0 = _max(x0, 0);
+        x1 = _min(x1, _min(state->system_x, framebuffer->width - 1));
+
+        if (x0 > x1) {
+                return true;
+        }
+
+        const uint32_t count = x1 - x0 + 1;
+        const uint16_t color = draw->colr;
+
+        state->stats->pixels += count;
+
+        if (framebuffer->bpp == 8) {
+                uint8_t * const pixels =
+                    &((uint8_t *)framebuffer->pixels)[(y * framebuffer->width) + x0];
+
+                (void)memset(pixels, color & 0xFF, count);
+
+                return true;
+        }
+
+        uint16_t * const pixels =
+            &((uint16_t *)framebuffer->pixels)[(y * framebuffer->width) + x0];
+
+        for (uint32_t i = 0; i < count; i++) {
+                pixels[i] = color;
+        }
+
+        return true;
+}
+
+/* Any other horizontal line. As it never gets an extra pixel, it is drawn
+ * in two passes. The first follows the line as the VDP1 does, for the
+ * texels, end codes and gouraud steps, and keeps the pixels inside the
+ * clipping windows. The second applies the color calculation to the whole
+ * span, in loops written so that compilers vectorize them. Returns false
+ * for the cases left to _line_draw() */
+static bool
+_span_draw(const draw_t *draw, point_t a, point_t b, row_t *row,
+    const gouraud_t *gouraud_a, const gouraud_t *gouraud_b)
+{
+        state_t * const state = draw->state;
+        vdp1ref_framebuffer_t * const framebuffer = state->framebuffer;
+
+        const uint16_t user_clip_outside = PMOD_USER_CLIP_ENABLE | PMOD_USER_CLIP_OUTSIDE;
+
+        if (((draw->pmod & user_clip_outside) == user_clip_outside) ||
+            (framebuffer->width > SPAN_COUNT_MAX)) {
+                return false;
+        }
+
+        int32_t clip_x0 = 0;
+        int32_t clip_y0 = 0;
+        int32_t clip_x1 = _min(state->system_x, framebuffer->width - 1);
+        int32_t clip_y1 = _min(state->system_y, framebuffer->height - 1);
+
+        if ((draw->pmod & PMOD_USER_CLIP_ENABLE) != 0) {
+                clip_x0 = _max(clip_x0, state->user_x0);
+                clip_y0 = _max(clip_y0, state->user_y0);
+                clip_x1 = _min(clip_x1, state->user_x1);
+                clip_y1 = _min(clip_y1, state->user_y1);
+        }
+
+        const int32_t y = a.y;
+        const int32_t left = _max(_min(a.x, b.x), clip_x0);
+        const int32_t right = _min(_max(a.x, b.x), clip_x1);
+
+        if ((y < clip_y0) || (y > clip_y1) || (left > right)) {
+                return true;
+        }
+
+        const uint32_t count = right - left + 1;
+        const int32_t steps = _abs(b.x - a.x);
+        const int32_t sx = _sign(b.x - a.x);
+
+        uint16_t colors[SPAN_COUNT_MAX];
+        uint16_t masks[SPAN_COUNT_MAX];
+        int16_t channels[3][SPAN_COUNT_MAX];
+
+        for (uint32_t k = 0; k < count; k++) {
+                masks[k] = 0x0000;
+        }
+
+        stepper_t u = { 0 };
+        gouraud_stepper_t gouraud = { { { 0 } } };
+
+        if (row != NULL) {
+                const bool flip_h = (draw->ctrl & CTRL_FLIP_H) != 0;
+
+                row->end_codes = 0;
+                row->last_u = UINT32_MAX;
+
+                _stepper_init(&u, flip_h ? (int32_t)draw->width - 1 : 0,
+                    flip_h ? 0 : (int32_t)draw->width - 1, steps);
+        }
+
+        if (draw->gouraud) {
+                _gouraud_stepper_init(&gouraud, gouraud_a, gouraud_b, steps);
+        }
+
+        int32_t x = a.x;
+
+        for (int32_t i = 0; i <= steps; i++, x += sx) {
+                uint16_t color = draw->colr;
+                bool drawn = true;
+
+                if (row != NULL) {
+                        bool row_end = false;
+
+                        drawn = _texel_get(draw, row, u.value, &color, &row_end);
+
+                        if (row_end) {
+                                break;
+                        }
+
+                        _stepper_step(&u);
+                }
+
+                if ((x >= left) && (x <= right)) {
+                        const uint32_t k = x - left;
+
+                        colors[k] = color;
+                        masks[k] = drawn ? 0xFFFF : 0x0000;
+
+                        if (draw->gouraud) {
+                                channels[0][k] = gouraud.c[0].value;
+                                channels[1][k] = gouraud.c[1].value;
+                                channels[2][k] = gouraud.c[2].value;
+                        }
+                }
+
+                if (draw->gouraud) {
+                        _gouraud_stepper_step(&gouraud);
+                }
+        }
+
+        if ((draw->pmod & PMOD_MESH) != 0) {
+                for (uint32_t k = 0; k < count; k++) {
+                        masks[k] = ((((left + k) ^ y) & 1) != 0) ? 0x0000 : masks[k];
+                }
+        }
+
+        uint32_t plotted = 0;
+
+        for (uint32_t k = 0; k < count; k++) {
+                plotted += masks[k] & 1;
+        }
+
+        state->stats->pixels += plotted;
+
+        const uint32_t offset = (y * framebuffer->width) + left;
+
+        /* Color calculation does not apply to 8 bpp framebuffers */
+        if (framebuffer->bpp == 8) {
+                uint8_t * const pixels = &((uint8_t *)framebuffer->pixels)[offset];
+
+                for (uint32_t k = 0; k < count; k++) {
+                        pixels[k] = (masks[k] != 0) ? (colors[k] & 0xFF) : pixels[k];
+                }
+
+                return true;
+        }
+
+        uint16_t * const pixels = &((uint16_t *)framebuffer->pixels)[offset];
+
+        if (draw->gouraud) {
+                for (uint32_t k = 0; k < count; k++) {
+                        const uint16_t color = colors[k];
+
+                        colors[k] = (color & 0x8000) |
+                            _gouraud_channel_apply(color, 0, channels[0][k]) |
+                            _gouraud_channel_apply(color, 5, channels[1][k]) |
+                            _gouraud_channel_apply(color, 10, channels[2][k]);
+                }
+        }
+
+        if ((draw->pmod & PMOD_MSB_ON) != 0) {
+                for (uint32_t k = 0; k < count; k++) {
+                        colors[k] = pixels[k] | 0x8000;
+                }
+        } else {
+                switch (PMOD_CC_MODE(draw->pmod)) {
+                case CC_SHADOW:
+                        for (uint32_t k = 0; k < count; k++) {
+                                colors[k] = ((pixels[k] & 0x8000) != 0) ?
+                                    _half(pixels[k]) : pixels[k];
+                        }
+                        break;
+                case CC_HALF_LUMINANCE:
+                case CC_GOURAUD_HALF_LUMINANCE:
+                        for (uint32_t k = 0; k < count; k++) {
+                                colors[k] = _half(colors[k]);
+                        }
+                        break;
+                case CC_HALF_TRANSPARENT:
+                case CC_GOURAUD_HALF_TRANSPARENT:
+                        for (uint32_t k = 0; k < count; k++) {
+                                colors[k] = ((pixels[k] & 0x8000) != 0) ?
+                                    _average(colors[k], pixels[k]) : colors[k];
+                        }
+                        break;
+                default:
+                        break;
+                }
+        }
+
+        for (uint32_t k = 0; k < count; k++) {
+                pixels[k] = (colors[k] & masks[k]) | (pixels[k] & ~masks[k]);
+        }
+
+        return true;
+}
+
+/* A DDA line, both ends included. With aa, wherever both coordinates step,
+ * the pixel one step along the major axis is drawn too, with the color of
+ * the pixel before it. Textured lines span the whole row */
+static void
+_line_draw(const draw_t *draw, point_t a, point_t b, bool aa, row_t *row,
+    const gouraud_t *gouraud_a, const gouraud_t *gouraud_b)
+{
+        const int32_t dx = b.x - a.x;
+        const int32_t dy = b.y - a.y;
+        const int32_t adx = _abs(dx);
+        const int32_t ady = _abs(dy);
+        const int32_t sx = _sign(dx);
+        const int32_t sy = _sign(dy);
+        const bool x_major = (adx >= ady);
+        const int32_t steps = x_major ? adx : ady;
+
+        if (dy == 0) {
+                if (!draw->gouraud && _span_fill(draw, a.x, b.x, a.y)) {
+                        return;
+                }
+
+                if (_span_draw(draw, a, b, row, gouraud_a, gouraud_b)) {
+                        return;
+                }
+        }
+
+        stepper_t u = { 0 };
+        gouraud_stepper_t gouraud_stepper = { { { 0 } } };
+
+        if (row != NULL) {
+                const bool flip_h = (draw->ctrl & CTRL_FLIP_H) != 0;
+
+                row->end_codes = 0;
+                row->last_u = UINT32_MAX;
+
+                _stepper_init(&u, flip_h ? (int32_t)draw->width - 1 : 0,
+                    flip_h ? 0 : (int32_t)draw->width - 1, steps);
+        }
+
+        if (draw->gouraud) {
+                _gouraud_stepper_init(&gouraud_stepper, gouraud_a, gouraud_b, steps);
+        }
+
+        int32_t x = a.x;
+        int32_t y = a.y;
+        int32_t error = -steps;
+
+        for (int32_t i = 0; i <= steps; i++) {
+                uint16_t color = draw->colr;
+                gouraud_t gouraud = { { 0, 0, 0 } };
+
+                if (draw->gouraud) {
+                        _gouraud_stepper_get(&gouraud_stepper, &gouraud);
+                        _gouraud_stepper_step(&gouraud_stepper);
+                }
+
+                bool drawn = true;
+
+                if (row != NULL) {
+                        bool row_end = false;
+
+                        drawn = _texel_get(draw, row, u.value, &color, &row_end);
+
+                        if (row_end) {
+                                return;
+                        }
+
+                        _stepper_step(&u);
+                }
+
+                if (drawn) {
+                        _pixel_plot(draw, x, y, color, &gouraud);
+                }
+
+                if (i == steps) {
+                        break;
+                }
+
+                error += 2 * (x_major ? ady : adx);
+
+                if (error >= 0) {
+                        error -= 2 * steps;
+
+                        if (aa && drawn) {
+                                if (x_major) {
+                                        _pixel_plot(draw, x + sx, y, color, &gouraud);
+                                } else {
+                                        _pixel_plot(draw, x, y + sy, color, &gouraud);
+                                }
+                        }
+
+                        if (x_major) {
+                                y += sy;
+                        } else {
+                                x += sx;
+                        }
+                }
+
+                if (x_major) {
+                        x += sx;
+                } else {
+                        y += sy;
+                }
+        }
+}
+
+/* Quads are drawn as one line per step of the longer of the left (A to D)
+ * and right (B to C) edges. Both edges, the texture rows and the gouraud
+ * colors are stepped the same number of times */
+static void
+_quad_draw(const draw_t *draw, const point_t *points)
+{
+        const point_t a = points[0];
+        const point_t b = points[1];
+        const point_t c = points[2];
+        const point_t d = points[3];
+
+        const int32_t left = _max(_abs(d.x - a.x), _abs(d.y - a.y));
+        const int32_t right = _max(_abs(c.x - b.x), _abs(c.y - b.y));
+        const int32_t steps = _max(left, right);
+
+        const bool flip_v = (draw->ctrl & CTRL_FLIP_V) != 0;
+
+        stepper_t left_x;
+        stepper_t left_y;
+        stepper_t right_x;
+        stepper_t right_y;
+        stepper_t v;
+
+        _stepper_init(&left_x, a.x, d.x, steps);
+        _stepper_init(&left_y, a.y, d.y, steps);
+        _stepper_init(&right_x, b.x, c.x, steps);
+        _stepper_init(&right_y, b.y, c.y, steps);
+        _stepper_init(&v, flip_v ? (int32_t)draw->height - 1 : 0,
+            flip_v ? 0 : (int32_t)draw->height - 1, steps);
+
+        gouraud_stepper_t gouraud_left;
+        gouraud_stepper_t gouraud_right;
+
+        if (draw->gouraud) {
+                _gouraud_stepper_init(&gouraud_left, &draw->gouraud_colors[0],
+                    &draw->gouraud_colors[3], steps);
+                _gouraud_stepper_init(&gouraud_right, &draw->gouraud_colors[1],
+                    &draw->gouraud_colors[2], steps);
+        }
+
+        for (int32_t i = 0; i <= steps; i++) {
+                const point_t l = { left_x.value, left_y.value };
+                const point_t r = { right_x.value, right_y.value };
+
+                gouraud_t gouraud_l = { { 0, 0, 0 } };
+                gouraud_t gouraud_r = { { 0, 0, 0 } };
+
+                if (draw->gouraud) {
+                        _gouraud_stepper_get(&gouraud_left, &gouraud_l);
+                        _gouraud_stepper_get(&gouraud_right, &gouraud_r);
+                        _gouraud_stepper_step(&gouraud_left);
+                        _gouraud_stepper_step(&gouraud_right);
+                }
+
+                if (draw->textured) {
+                        row_t row;
+
+                        row.v = v.value;
+
+                        _line_draw(draw, l, r, true, &row, &gouraud_l, &gouraud_r);
+                } else {
+                        _line_draw(draw, l, r, true, NULL, &gouraud_l, &gouraud_r);
+                }
+
+                _stepper_step(&left_x);
+                _stepper_step(&left_y);
+                _stepper_step(&right_x);
+                _stepper_step(&right_y);
+                _stepper_step(&v);
+        }
+}
+
+static point_t
+_vertex_get(const state_t *state, const uint8_t *cmdt, uint32_t vertex)
+{
+        point_t point;
+
+        point.x = _coord_get((cmdt[0x0C + (vertex * 4)] << 8) | cmdt[0x0D + (vertex * 4)]) +
+            state->local_x;
+        point.y = _coord_get((cmdt[0x0E + (vertex * 4)] << 8) | cmdt[0x0F + (vertex * 4)]) +
+            state->local_y;
+
+        return point;
+}
+
+/* Corners of a scaled sprite. Without a zoom point, A and C are opposite
+ * corners. Otherwise A is the zoom point and B the size on screen */
+static void
+_scaled_points_get(const state_t *state, const uint8_t *cmdt, uint16_t ctrl,
+    point_t *points)
+{
+        const uint32_t zoom_point = CTRL_ZOOM_POINT(ctrl);
+        const point_t a = _vertex_get(state, cmdt, 0);
+
+        int32_t x0;
+        int32_t y0;
+        int32_t x1;
+        int32_t y1;
+
+        if (zoom_point == 0) {
+                const point_t c = _vertex_get(state, cmdt, 2);
+
+                x0 = a.x;
+                y0 = a.y;
+                x1 = c.x;
+                y1 = c.y;
+        } else {
+                const int32_t width = _coord_get((cmdt[0x10] << 8) | cmdt[0x11]);
+                const int32_t height = _coord_get((cmdt[0x12] << 8) | cmdt[0x13]);
+
+                switch (zoom_point & 3) {
+                case 2:
+                        x0 = a.x - (width / 2);
+                        break;
+                case 3:
+                        x0 = a.x - width;
+                        break;
+                default:
+                        x0 = a.x;
+                        break;
+                }
+
+                switch ((zoom_point >> 2) & 3) {
+                case 2:
+                        y0 = a.y - (height / 2);
+                        break;
+                case 3:
+                        y0 = a.y - height;
+                        break;
+                default:
+                        y0 = a.y;
+                        break;
+                }
+
+                x1 = x0 + width;
+                y1 = y0 + height;
+        }
+
+        points[0].x = x0;
+        points[0].y = y0;
+        points[1].x = x1;
+        points[1].y = y0;
+        points[2].x = x1;
+        points[2].y = y1;
+        points[3].x = x0;
+        points[3].y = y1;
+}
+
+static void
+_cmdt_draw(state_t *state, const uint8_t *cmdt, uint16_t ctrl)
+{
+        const uint32_t command = CTRL_COMMAND(ctrl);
+
+        draw_t draw;
+        point_t points[4];
+
+        draw.state = state;
+        draw.ctrl = ctrl;
+        draw.pmod = (cmdt[0x04] << 8) | cmdt[0x05];
+        draw.colr = (cmdt[0x06] << 8) | cmdt[0x07];
+        draw.char_base = ((cmdt[0x08] << 8) | cmdt[0x09]) << 3;
+        draw.width = ((cmdt[0x0A] & 0x3F) << 3);
+        draw.height = cmdt[0x0B];
+        draw.textured = (command <= COMMAND_DISTORTED_SPRITE_ALT);
+
+        const uint32_t cc_mode = PMOD_CC_MODE(draw.pmod);
+
+        draw.gouraud = (cc_mode == CC_GOURAUD) ||
+            (cc_mode == CC_GOURAUD_HALF_LUMINANCE) ||
+            (cc_mode == CC_GOURAUD_HALF_TRANSPARENT);
+
+        if (draw.gouraud) {
+                const uint32_t table = (uint32_t)((cmdt[0x1C] << 8) | cmdt[0x1D]) << 3;
+
+                for (uint32_t i = 0; i < 4; i++) {
+                        _gouraud_get(_vram_u16_get(state->vram, table + (i * 2)),
+                            &draw.gouraud_colors[i]);
+                }
+        }
+
+        if (draw.textured && ((draw.width == 0) || (draw.height == 0))) {
+                return;
+        }
+
+        switch (command) {
+        case COMMAND_NORMAL_SPRITE:
+                points[0] = _vertex_get(state, cmdt, 0);
+                points[1].x = points[0].x + draw.width - 1;
+                points[1].y = points[0].y;
+                points[2].x = points[1].x;
+                points[2].y = points[0].y + draw.height - 1;
+                points[3].x = points[0].x;
+                points[3].y = points[2].y;
+
+                _quad_draw(&draw, points);
+                break;
+        case COMMAND_SCALED_SPRITE:
+                _scaled_points_get(state, cmdt, ctrl, points);
+                _quad_draw(&draw, points);
+                break;
+        case COMMAND_DISTORTED_SPRITE:
+        case COMMAND_DISTORTED_SPRITE_ALT:
+        case COMMAND_POLYGON:
+                for (uint32_t i = 0; i < 4; i++) {
+                        points[i] = _vertex_get(state, cmdt, i);
+                }
+
+                _quad_draw(&draw, points);
+                break;
+        case COMMAND_POLYLINE:
+        case COMMAND_POLYLINE_ALT:
+                for (uint32_t i = 0; i < 4; i++) {
+                        points[i] = _vertex_get(state, cmdt, i);
+                }
+
+                for (uint32_t i = 0; i < 4; i++) {
+                        const uint32_t j = (i + 1) & 3;
+
+                        _line_draw(&draw, points[i], points[j], false, NULL,
+                            &draw.gouraud_colors[i], &draw.gouraud_colors[j]);
+                }
+                break;
+        case COMMAND_LINE:
+                points[0] = _vertex_get(state, cmdt, 0);
+                points[1] = _vertex_get(state, cmdt, 1);
+
+                _line_draw(&draw, points[0], points[1], false, NULL,
+                    &draw.gouraud_colors[0], &draw.gouraud_colors[1]);
+                break;
+        }
+}
+
+static void
+_cmdt_run(state_t *state, const uint8_t *cmdt, uint16_t ctrl)
+{
+        const int32_t xa = ((cmdt[0x0C] << 8) | cmdt[0x0D]);
+        const int32_t ya = ((cmdt[0x0E] << 8) | cmdt[0x0F]);
+        const int32_t xc = ((cmdt[0x14] << 8) | cmdt[0x15]);
+        const int32_t yc = ((cmdt[0x16] << 8) | cmdt[0x17]);
+
+        switch (CTRL_COMMAND(ctrl)) {
+        case COMMAND_USER_CLIP:
+        case COMMAND_USER_CLIP_ALT:
+                state->user_x0 = xa & 0x3FF;
+                state->user_y0 = ya & 0x1FF;
+                state->user_x1 = xc & 0x3FF;
+                state->user_y1 = yc & 0x1FF;
+                break;
+        case COMMAND_SYSTEM_CLIP:
+                state->system_x = xc & 0x3FF;
+                state->system_y = yc & 0x1FF;
+                break;
+        case COMMAND_LOCAL_COORD:
+                state->local_x = _coord_get(xa);
+                state->local_y = _coord_get(ya);
+                break;
+        default:
+                _cmdt_draw(state, cmdt, ctrl);
+                break;
+        }
+}
+
+void
+vdp1ref_cmdts_put(uint8_t *vram, uint32_t index, const vdp1ref_cmdt_t *cmdts,
+    uint32_t count)
+{
+        for (uint32_t i = 0; i < count; i++) {
+                const uint16_t *words = (const uint16_t *)&cmdts[i];
+                uint8_t * const cmdt = &vram[((index + i) * CMDT_SIZE) & (VDP1REF_VRAM_SIZE - 1)];
+
+                for (uint32_t w = 0; w < (CMDT_SIZE / 2); w++) {
+                        cmdt[(2 * w) + 0] = words[w] >> 8;
+                        cmdt[(2 * w) + 1] = words[w] & 0xFF;
+                }
+        }
+}
+
+void
+vdp1ref_framebuffer_erase(vdp1ref_framebuffer_t *framebuffer, uint16_t value)
+{
+        const uint32_t count = framebuffer->width * framebuffer->height;
+
+        if (framebuffer->bpp == 8) {
+                (void)memset(framebuffer->pixels, value & 0xFF, count);
+
+                return;
+        }
+
+        uint16_t * const pixels = framebuffer->pixels;
+
+        for (uint32_t i = 0; i < count; i++) {
+                pixels[i] = value;
+        }
+}
+
+/* The list is followed as the VDP1 does, jumps and calls included, with a
+ * single return address. Clipping and local coordinates start out as the
+ * whole framebuffer and 0,0 */
+void
+vdp1ref_render(const uint8_t *vram, vdp1ref_framebuffer_t *framebuffer,
+    vdp1ref_stats_t *stats)
+{
+        state_t state;
+        vdp1ref_stats_t ignored;
+
+        if (stats == NULL) {
+                stats = &ignored;
+        }
+
+        (void)memset(stats, 0x00, sizeof(*stats));
+
+        state.vram = vram;
+        state.framebuffer = framebuffer;
+        state.stats = stats;
+        state.local_x = 0;
+        state.local_y = 0;
+        state.system_x = framebuffer->width - 1;
+        state.system_y = framebuffer->height - 1;
+        state.user_x0 = 0;
+        state.user_y0 = 0;
+        state.user_x1 = framebuffer->width - 1;
+        state.user_y1 = framebuffer->height - 1;
+
+        uint32_t address = 0;
+        uint32_t return_address = 0;
+        bool returnable = false;
+
+        while (true) {
+                if (stats->cmdts == VDP1REF_CMDT_COUNT_MAX) {
+                        stats->looped = true;
+
+                        break;
+                }
+
+                const uint8_t * const cmdt = &vram[address];
+                const uint16_t ctrl = (cmdt[0] << 8) | cmdt[1];
+                const uint32_t link = (uint32_t)((cmdt[2] << 8) | cmdt[3]) << 3;
+
+                if ((ctrl & CTRL_END) != 0) {
+                        break;
+                }
+
+                stats->cmdts++;
+
+                if ((ctrl & CTRL_JUMP_SKIP) == 0) {
+                        _cmdt_run(&state, cmdt, ctrl);
+                }
+
+                const uint32_t next = (address + CMDT_SIZE) & (VDP1REF_VRAM_SIZE - 1);
+
+                switch (CTRL_JUMP(ctrl)) {
+                case JUMP_ASSIGN:
+                        address = link;
+                        break;
+                case JUMP_CALL:
+                        return_address = next;
+                        returnable = true;
+                        address = link;
+                        break;
+                case JUMP_RETURN:
+                        address = returnable ? return_address : next;
+                        returnable = false;
+                        break;
+                default:
+                        address = next;
+                        break;
+                }
+
+                address &= (VDP1REF_VRAM_SIZE - 1) & ~(uint32_t)(CMDT_SIZE - 1);
+        }
+}
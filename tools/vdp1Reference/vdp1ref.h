@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#ifndef VDP1REF_H_
+#define VDP1REF_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Reference VDP1 rasterizer. It walks a command list in an image of VDP1
+ * VRAM, exactly as the VDP1 does, and draws into a framebuffer:
+ *
+ *   - VRAM is 512 KB in the byte order of the Saturn (big endian), as
+ *     dumped from hardware or an emulator
+ *   - The framebuffer holds one 16-bit pixel (host order) per pixel in 16
+ *     bpp modes, and one byte per pixel in 8 bpp modes
+ *
+ * Every quad, sprite or polygon, is drawn as the VDP1 does: one line per
+ * step of its longer left or right edge, each line with an extra pixel
+ * wherever both coordinates step, so that no holes are left. Lines and
+ * polylines are plain DDA lines, both ends included. Edges, texels and
+ * gouraud colors are all stepped with integer error terms, as the VDP1
+ * does, rather than interpolated.
+ *
+ * These rules follow the VDP1 manual. They have not been checked pixel for
+ * pixel against hardware captures yet */
+
+#define VDP1REF_VRAM_SIZE       (0x80000)
+
+/* Commands run before giving up on a list that loops */
+#define VDP1REF_CMDT_COUNT_MAX  (0x80000 / 32)
+
+/* Same layout as vdp1_cmdt_t, in host order */
+typedef struct {
+        uint16_t cmd_ctrl;
+        uint16_t cmd_link;
+        uint16_t cmd_pmod;
+        uint16_t cmd_colr;
+        uint16_t cmd_srca;
+        uint16_t cmd_size;
+        int16_t cmd_xa;
+        int16_t cmd_ya;
+        int16_t cmd_xb;
+        int16_t cmd_yb;
+        int16_t cmd_xc;
+        int16_t cmd_yc;
+        int16_t cmd_xd;
+        int16_t cmd_yd;
+        uint16_t cmd_grda;
+        uint16_t reserved;
+} vdp1ref_cmdt_t;
+
+typedef struct {
+        uint16_t width;
+        uint16_t height;
+        uint8_t bpp;            /* 8 or 16 */
+        void *pixels;
+} vdp1ref_framebuffer_t;
+
+typedef struct {
+        uint32_t cmdts;         /* Commands read, skipped ones included */
+        uint32_t pixels;        /* Pixels written */
+        bool looped;            /* Stopped at VDP1REF_CMDT_COUNT_MAX */
+} vdp1ref_stats_t;
+
+/* Writes count commands into VRAM, from command index */
+extern void vdp1ref_cmdts_put(uint8_t *vram, uint32_t index,
+    const vdp1ref_cmdt_t *cmdts, uint32_t count);
+
+/* Fills the framebuffer with a value, as the VDP1 erase does */
+extern void vdp1ref_framebuffer_erase(vdp1ref_framebuffer_t *framebuffer,
+    uint16_t value);
+
+/* Draws the list starting at the first command of VRAM */
+extern void vdp1ref_render(const uint8_t *vram,
+    vdp1ref_framebuffer_t *framebuffer, vdp1ref_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* !VDP1REF_H_ */
@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#include <yaul.h>
+
+#include "clipping.h"
+#include "timer.h"
+
+#define SCREEN_WIDTH    320
+#define SCREEN_HEIGHT   224
+
+/* Side of the square primitives, in pixels */
+#define CLIPPING_SIZE           (32)
+
+/* Primitives are spread a little, and always stay within their placement */
+#define CLIPPING_JITTER(i)      (((i) * 7) % 16)
+
+#define ORDER_SYSTEM_CLIP_COORDS_INDEX  0
+#define ORDER_USER_CLIP_COORDS_INDEX    1
+#define ORDER_LOCAL_COORDS_INDEX        2
+#define ORDER_PRIMITIVE_INDEX           3
+#define ORDER_COUNT                     (ORDER_PRIMITIVE_INDEX + CLIPPING_COUNT + 1)
+
+typedef struct {
+        int16_t x0;
+        int16_t y0;
+        int16_t x1;
+        int16_t y1;
+} clipping_rect_t;
+
+static const clipping_rect_t _windows[CLIPPING_WINDOW_COUNT] = {
+        {  0,  0, SCREEN_WIDTH - 1, SCREEN_HEIGHT - 1 },
+        { 80, 56,              239,               167 }
+};
+
+/* Upper left corner of the first primitive, by window then placement. A
+ * partial primitive straddles the right edge of the window, an outside one
+ * is still on screen when the window is the user one */
+static const int16_vec2_t _origins[CLIPPING_WINDOW_COUNT][CLIPPING_PLACEMENT_COUNT] = {
+        {
+                INT16_VEC2_INITIALIZER(                  64, 64),
+                INT16_VEC2_INITIALIZER(   SCREEN_WIDTH - 16, 64),
+                INT16_VEC2_INITIALIZER(   SCREEN_WIDTH + 32, 64)
+        },
+        {
+                INT16_VEC2_INITIALIZER(          144, 96),
+                INT16_VEC2_INITIALIZER(     240 - 16, 96),
+                INT16_VEC2_INITIALIZER(           16, 96)
+        }
+};
+
+static const char *_window_names[CLIPPING_WINDOW_COUNT] = {
+        "system",
+        "user"
+};
+
+static const char *_placement_names[CLIPPING_PLACEMENT_COUNT] = {
+        "inside",
+        "partial",
+        "outside"
+};
+
+static const char *_reject_names[CLIPPING_REJECT_COUNT] = {
+        "preclip",
+        "pixel",
+        "cpu cull"
+};
+
+static vdp1_cmdt_list_t *_cmdt_list = NULL;
+
+static inline bool
+_rect_outside(const clipping_rect_t *window, int16_t x, int16_t y)
+{
+        return (((x + CLIPPING_SIZE - 1) < window->x0) || (x > window->x1) ||
+                ((y + CLIPPING_SIZE - 1) < window->y0) || (y > window->y1));
+}
+
+const char *
+clipping_window_name_get(uint32_t window)
+{
+        return _window_names[window];
+}
+
+const char *
+clipping_placement_name_get(uint32_t placement)
+{
+        return _placement_names[placement];
+}
+
+const char *
+clipping_reject_name_get(uint32_t reject)
+{
+        return _reject_names[reject];
+}
+
+void
+clipping_init(void)
+{
+        static const int16_vec2_t system_clip_coord =
+            INT16_VEC2_INITIALIZER(SCREEN_WIDTH - 1,
+                                   SCREEN_HEIGHT - 1);
+
+        static const int16_vec2_t local_coord =
+            INT16_VEC2_INITIALIZER(0, 0);
+
+        const clipping_rect_t * const user = &_windows[CLIPPING_WINDOW_USER];
+
+        const int16_vec2_t user_clip_coords[2] = {
+                INT16_VEC2_INITIALIZER(user->x0, user->y0),
+                INT16_VEC2_INITIALIZER(user->x1, user->y1)
+        };
+
+        _cmdt_list = vdp1_cmdt_list_alloc(ORDER_COUNT);
+
+        (void)memset(&_cmdt_list->cmdts[0], 0x00,
+            sizeof(vdp1_cmdt_t) * ORDER_COUNT);
+
+        vdp1_cmdt_t * const cmdts = &_cmdt_list->cmdts[0];
+
+        vdp1_cmdt_system_clip_coord_set(&cmdts[ORDER_SYSTEM_CLIP_COORDS_INDEX]);
+        vdp1_cmdt_param_vertex_set(&cmdts[ORDER_SYSTEM_CLIP_COORDS_INDEX],
+            CMDT_VTX_SYSTEM_CLIP,
+            &system_clip_coord);
+
+        vdp1_cmdt_user_clip_coord_set(&cmdts[ORDER_USER_CLIP_COORDS_INDEX]);
+        vdp1_cmdt_param_vertex_set(&cmdts[ORDER_USER_CLIP_COORDS_INDEX],
+            CMDT_VTX_USER_CLIP_UL,
+            &user_clip_coords[0]);
+        vdp1_cmdt_param_vertex_set(&cmdts[ORDER_USER_CLIP_COORDS_INDEX],
+            CMDT_VTX_USER_CLIP_LR,
+            &user_clip_coords[1]);
+
+        vdp1_cmdt_local_coord_set(&cmdts[ORDER_LOCAL_COORDS_INDEX]);
+        vdp1_cmdt_param_vertex_set(&cmdts[ORDER_LOCAL_COORDS_INDEX],
+            CMDT_VTX_LOCAL_COORD,
+            &local_coord);
+}
+
+/* Build then draw CLIPPING_COUNT polygons placed against window. Only the
+ * CPU cull tests each polygon against the window, so that both build times
+ * can be compared */
+void
+clipping_run(uint32_t window, uint32_t placement, uint32_t reject,
+    clipping_result_t *result)
+{
+        const clipping_rect_t * const rect = &_windows[window];
+        const int16_vec2_t * const origin = &_origins[window][placement];
+
+        vdp1_cmdt_draw_mode_t draw_mode = {
+                .raw = 0x0000
+        };
+
+        draw_mode.bits.pre_clipping_disable = (reject == CLIPPING_REJECT_PIXEL);
+        draw_mode.bits.user_clipping_enable = (window == CLIPPING_WINDOW_USER);
+
+        int16_vec2_t points[4];
+        uint16_t count = 0;
+        uint32_t i;
+
+        const uint32_t build_start = timer_ticks_get();
+
+        for (i = 0; i < CLIPPING_COUNT; i++) {
+                const int16_t x = origin->x - CLIPPING_JITTER(i);
+                const int16_t y = origin->y + CLIPPING_JITTER(i);
+
+                if ((reject == CLIPPING_REJECT_CPU) && _rect_outside(rect, x, y)) {
+                        continue;
+                }
+
+                vdp1_cmdt_t * const cmdt =
+                    &_cmdt_list->cmdts[ORDER_PRIMITIVE_INDEX + count];
+
+                points[0].x = x;
+                points[0].y = y + CLIPPING_SIZE - 1;
+                points[1].x = x + CLIPPING_SIZE - 1;
+                points[1].y = y + CLIPPING_SIZE - 1;
+                points[2].x = x + CLIPPING_SIZE - 1;
+                points[2].y = y;
+                points[3].x = x;
+                points[3].y = y;
+
+                vdp1_cmdt_polygon_set(cmdt);
+                vdp1_cmdt_param_draw_mode_set(cmdt, draw_mode);
+                vdp1_cmdt_param_color_set(cmdt, COLOR_RGB1555(1, 31, i % 32, 0));
+                vdp1_cmdt_param_vertices_set(cmdt, &points[0]);
+
+                count++;
+        }
+
+        const uint16_t end_index = ORDER_PRIMITIVE_INDEX + count;
+
+        vdp1_cmdt_end_set(&_cmdt_list->cmdts[end_index]);
+
+        _cmdt_list->count = end_index + 1;
+
+        result->build_ticks = timer_ticks_get() - build_start;
+        result->count = count;
+
+        vdp1_sync_cmdt_list_put(_cmdt_list, 0);
+        const uint32_t draw_start = timer_ticks_get();
+        vdp1_sync_render();
+        vdp1_sync();
+        while (vdp1_cmdt_current_get() != end_index) {
+        }
+        result->draw_ticks = timer_ticks_get() - draw_start;
+        vdp1_sync_wait();
+}
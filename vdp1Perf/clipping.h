@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#ifndef CLIPPING_H_
+#define CLIPPING_H_
+
+#include <yaul.h>
+
+#define CLIPPING_WINDOW_SYSTEM          0
+#define CLIPPING_WINDOW_USER            1
+#define CLIPPING_WINDOW_COUNT           2
+
+#define CLIPPING_PLACEMENT_INSIDE       0
+#define CLIPPING_PLACEMENT_PARTIAL      1
+#define CLIPPING_PLACEMENT_OUTSIDE      2
+#define CLIPPING_PLACEMENT_COUNT        3
+
+#define CLIPPING_REJECT_PRE_CLIPPING    0 /* VDP1 skips whole primitives */
+#define CLIPPING_REJECT_PIXEL           1 /* Pre-clipping off */
+#define CLIPPING_REJECT_CPU             2 /* Culled before the list is built */
+#define CLIPPING_REJECT_COUNT           3
+
+/* Primitives of each measurement */
+#define CLIPPING_COUNT                  (256)
+
+typedef struct {
+        uint32_t build_ticks;   /* CPU time to build the list */
+        uint32_t draw_ticks;
+        uint16_t count;         /* Primitives left in the list */
+} clipping_result_t;
+
+extern const char *clipping_window_name_get(uint32_t window);
+extern const char *clipping_placement_name_get(uint32_t placement);
+extern const char *clipping_reject_name_get(uint32_t reject);
+
+extern void clipping_init(void);
+extern void clipping_run(uint32_t window, uint32_t placement, uint32_t reject,
+    clipping_result_t *result);
+
+#endif /* !CLIPPING_H_ */
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#include <yaul.h>
+
+#include "ctex.h"
+#include "decompress.h"
+#include "scudma.h"
+#include "timer.h"
+
+/* Largest frame decoded into work RAM */
+#define DECOMPRESS_FRAME_SIZE_MAX (8192)
+
+extern uint8_t asset_zoom_tex[];
+extern uint8_t asset_zoom_ctx[];
+
+static const char * const _method_names[DECOMPRESS_METHOD_COUNT] = {
+        "raw CPU",
+        "raw SCU",
+        "ctex CPU",
+        "ctex SCU"
+};
+
+/* A frame is decoded into one buffer while the other is moved by the SCU */
+static uint8_t _buffers[2][DECOMPRESS_FRAME_SIZE_MAX] __aligned(4);
+
+static scu_dma_handle_t _scu_handle;
+
+static void
+_scu_dma_start(uint32_t dst, const void *src, uint32_t len)
+{
+        scudma_direct_config_set(&_scu_handle, dst, src, len);
+        scudma_start();
+}
+
+/* Longword writes to VDP1 VRAM, then a word and a byte for the tail. src
+ * must be 4-byte aligned */
+static void
+_cpu_copy(uint32_t dst, const void *src, uint32_t size)
+{
+        const uint32_t *s = src;
+        volatile uint32_t *d = (volatile uint32_t *)dst;
+        uint32_t i;
+
+        for (i = 0; i < (size / 16); i++, s += 4, d += 4) {
+                d[0] = s[0];
+                d[1] = s[1];
+                d[2] = s[2];
+                d[3] = s[3];
+        }
+
+        for (i = 0; i < ((size & 15) / sizeof(uint32_t)); i++) {
+                *d++ = *s++;
+        }
+
+        const uint16_t *s16 = (const uint16_t *)s;
+        volatile uint16_t *d16 = (volatile uint16_t *)d;
+
+        if ((size & 2) != 0) {
+                *d16++ = *s16++;
+        }
+
+        if ((size & 1) != 0) {
+                *(volatile uint8_t *)d16 = *(const uint8_t *)s16;
+        }
+}
+
+/* Each frame is decoded into work RAM, where the copies read back from,
+ * then written to VDP1 VRAM in longwords */
+static void
+_ctex_cpu_decode(const ctex_header_t *header)
+{
+        uint32_t frame;
+
+        for (frame = 0; frame < header->frame_count; frame++) {
+                ctex_frame_decode(header, frame, _buffers[0]);
+
+                _cpu_copy(VDP1_VRAM(frame * header->frame_size), _buffers[0],
+                    header->frame_size);
+        }
+}
+
+/* Frame n is decoded while frame n - 1 is on its way to VDP1 VRAM */
+static void
+_ctex_scu_decode(const ctex_header_t *header)
+{
+        uint32_t frame;
+
+        for (frame = 0; frame < header->frame_count; frame++) {
+                uint8_t * const buffer = _buffers[frame & 1];
+
+                ctex_frame_decode(header, frame, buffer);
+
+                scudma_wait();
+                _scu_dma_start(VDP1_VRAM(frame * header->frame_size), buffer,
+                    header->frame_size);
+        }
+
+        scudma_wait();
+}
+
+const char *
+decompress_method_name_get(uint32_t method)
+{
+        return _method_names[method];
+}
+
+uint32_t
+decompress_raw_size_get(void)
+{
+        const ctex_header_t * const header = (const ctex_header_t *)asset_zoom_ctx;
+
+        return header->frame_count * header->frame_size;
+}
+
+uint32_t
+decompress_compressed_size_get(void)
+{
+        const ctex_header_t * const header = (const ctex_header_t *)asset_zoom_ctx;
+
+        return header->offsets[header->frame_count];
+}
+
+/* FRT ticks to get every frame of the zoom texture into VDP1 VRAM, from
+ * its start. The VDP1 must not be drawing, and whatever VDP1 VRAM held
+ * there is lost */
+uint32_t
+decompress_ticks_get(uint32_t method)
+{
+        const ctex_header_t * const header = (const ctex_header_t *)asset_zoom_ctx;
+        const uint32_t size = decompress_raw_size_get();
+
+        if (!ctex_valid(header) || (header->frame_size > DECOMPRESS_FRAME_SIZE_MAX)) {
+                return 0;
+        }
+
+        const uint32_t start = timer_ticks_get();
+
+        switch (method) {
+        case DECOMPRESS_METHOD_RAW_CPU:
+                _cpu_copy(VDP1_VRAM(0), asset_zoom_tex, size);
+                break;
+        case DECOMPRESS_METHOD_RAW_SCU:
+                _scu_dma_start(VDP1_VRAM(0), asset_zoom_tex, size);
+                scudma_wait();
+                break;
+        case DECOMPRESS_METHOD_CPU:
+                _ctex_cpu_decode(header);
+                break;
+        case DECOMPRESS_METHOD_SCU:
+                _ctex_scu_decode(header);
+                break;
+        }
+
+        return timer_ticks_get() - start;
+}
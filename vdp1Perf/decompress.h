@@ -0,0 +1,24 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#ifndef DECOMPRESS_H_
+#define DECOMPRESS_H_
+
+#include <yaul.h>
+
+#define DECOMPRESS_METHOD_RAW_CPU       0 /* Longword copy of ZOOM.TEX */
+#define DECOMPRESS_METHOD_RAW_SCU       1 /* SCU DMA of ZOOM.TEX */
+#define DECOMPRESS_METHOD_CPU           2 /* ZOOM.CTX decoded, copied by the CPU */
+#define DECOMPRESS_METHOD_SCU           3 /* ZOOM.CTX decoded, moved by SCU DMA */
+#define DECOMPRESS_METHOD_COUNT         4
+
+extern const char *decompress_method_name_get(uint32_t method);
+extern uint32_t decompress_raw_size_get(void);
+extern uint32_t decompress_compressed_size_get(void);
+extern uint32_t decompress_ticks_get(uint32_t method);
+
+#endif /* !DECOMPRESS_H_ */
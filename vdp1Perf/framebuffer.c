@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#include <yaul.h>
+
+#include "framebuffer.h"
+#include "timer.h"
+
+/* TV mode register. With VBE, the framebuffer about to be drawn is erased
+ * during VBlank, before the change and the plot. Only valid with a manual
+ * frame change */
+#define VDP1_TVMR               (0x25D00000)
+#define VDP1_TVMR_8BPP          (1 << 0)
+#define VDP1_TVMR_VBE           (1 << 3)
+
+/* Frame buffer change register. FCM and FCT both set ask for one change at
+ * the next VBlank, and have to be written again for every frame */
+#define VDP1_FBCR               (0x25D00002)
+#define VDP1_FBCR_FCT           (1 << 0)
+#define VDP1_FBCR_FCM           (1 << 1)
+#define VDP1_FBCR_DIE           (1 << 3)
+
+/* Plot trigger register. Set to automatic, the VDP1 erases then draws at
+ * every frame change */
+#define VDP1_PTMR               (0x25D00004)
+#define VDP1_PTMR_IDLE          (0x0000)
+#define VDP1_PTMR_AUTO          (0x0002)
+
+/* Transfer end status register, cleared by a frame change and set once the
+ * end command is read */
+#define VDP1_EDSR               (0x25D00010)
+#define VDP1_EDSR_CEF           (1 << 1)
+
+#define ORDER_SYSTEM_CLIP_COORDS_INDEX  0
+#define ORDER_LOCAL_COORDS_INDEX        1
+#define ORDER_POLYGON_INDEX             2
+#define ORDER_COUNT                     (ORDER_POLYGON_INDEX + FRAMEBUFFER_FILL_COUNT + 1)
+
+/* A hi-res framebuffer is only 8bpp. Interlaced modes draw every other line
+ * in each field */
+static const framebuffer_mode_t _modes[FRAMEBUFFER_MODE_COUNT] = {
+        {
+                "320x224 16bpp",
+                VDP2_TVMD_HORZ_NORMAL_A, VDP2_TVMD_INTERLACE_NONE, 16, 320, 224
+        },
+        {
+                "320x224 8bpp",
+                VDP2_TVMD_HORZ_NORMAL_A, VDP2_TVMD_INTERLACE_NONE, 8, 320, 224
+        },
+        {
+                "352x224 16bpp",
+                VDP2_TVMD_HORZ_NORMAL_B, VDP2_TVMD_INTERLACE_NONE, 16, 352, 224
+        },
+        {
+                "704x224 8bpp",
+                VDP2_TVMD_HORZ_HIRESO_B, VDP2_TVMD_INTERLACE_NONE, 8, 704, 224
+        },
+        {
+                "320x448i 16bpp",
+                VDP2_TVMD_HORZ_NORMAL_A, VDP2_TVMD_INTERLACE_DOUBLE, 16, 320, 224
+        },
+        {
+                "704x448i 8bpp",
+                VDP2_TVMD_HORZ_HIRESO_B, VDP2_TVMD_INTERLACE_DOUBLE, 8, 704, 224
+        }
+};
+
+/* Full screen polygons, as the clear polygon of Vdp1Drawing */
+static vdp1_cmdt_list_t *_fill_cmdt_list = NULL;
+
+/* Nothing but the coordinates, so that a frame is all change and erase */
+static vdp1_cmdt_list_t *_change_cmdt_list = NULL;
+
+/* Mode and environment set last, to go back to after an erase */
+static const framebuffer_mode_t *_mode = NULL;
+static vdp1_env_t _env;
+
+static void
+_cmdt_list_coords_set(vdp1_cmdt_list_t *cmdt_list,
+    const framebuffer_mode_t *mode)
+{
+        const int16_vec2_t system_clip_coord =
+            INT16_VEC2_INITIALIZER(mode->width - 1, mode->height - 1);
+
+        static const int16_vec2_t local_coord =
+            INT16_VEC2_INITIALIZER(0, 0);
+
+        vdp1_cmdt_t * const cmdts = &cmdt_list->cmdts[0];
+
+        vdp1_cmdt_system_clip_coord_set(&cmdts[ORDER_SYSTEM_CLIP_COORDS_INDEX]);
+        vdp1_cmdt_param_vertex_set(&cmdts[ORDER_SYSTEM_CLIP_COORDS_INDEX],
+            CMDT_VTX_SYSTEM_CLIP,
+            &system_clip_coord);
+
+        vdp1_cmdt_local_coord_set(&cmdts[ORDER_LOCAL_COORDS_INDEX]);
+        vdp1_cmdt_param_vertex_set(&cmdts[ORDER_LOCAL_COORDS_INDEX],
+            CMDT_VTX_LOCAL_COORD,
+            &local_coord);
+}
+
+/* FRT ticks from the list reaching the VDP1 to the end of its drawing */
+static uint32_t
+_draw_ticks_get(vdp1_cmdt_list_t *cmdt_list)
+{
+        const uint16_t end_index = cmdt_list->count - 1;
+
+        vdp1_sync_cmdt_list_put(cmdt_list, 0);
+        const uint32_t start = timer_ticks_get();
+        vdp1_sync_render();
+        vdp1_sync();
+        while (vdp1_cmdt_current_get() != end_index) {
+        }
+        const uint32_t ticks = timer_ticks_get() - start;
+        vdp1_sync_wait();
+
+        return ticks;
+}
+
+const framebuffer_mode_t *
+framebuffer_mode_get(uint32_t mode)
+{
+        return &_modes[mode];
+}
+
+void
+framebuffer_init(void)
+{
+        _fill_cmdt_list = vdp1_cmdt_list_alloc(ORDER_COUNT);
+        _change_cmdt_list = vdp1_cmdt_list_alloc(ORDER_POLYGON_INDEX + 1);
+
+        (void)memset(&_fill_cmdt_list->cmdts[0], 0x00,
+            sizeof(vdp1_cmdt_t) * ORDER_COUNT);
+        (void)memset(&_change_cmdt_list->cmdts[0], 0x00,
+            sizeof(vdp1_cmdt_t) * (ORDER_POLYGON_INDEX + 1));
+
+        _fill_cmdt_list->count = ORDER_COUNT;
+        _change_cmdt_list->count = ORDER_POLYGON_INDEX + 1;
+
+        vdp1_cmdt_end_set(&_fill_cmdt_list->cmdts[ORDER_COUNT - 1]);
+        vdp1_cmdt_end_set(&_change_cmdt_list->cmdts[ORDER_POLYGON_INDEX]);
+}
+
+/* Switch the display and the VDP1 framebuffer to mode, with an erase
+ * window of the first erase_height lines */
+void
+framebuffer_mode_set(const framebuffer_mode_t *mode, uint16_t erase_height)
+{
+        static const vdp1_cmdt_draw_mode_t draw_mode = {
+                .raw = 0x0000
+        };
+
+        vdp1_env_t * const env = &_env;
+        uint32_t i;
+
+        vdp2_tvmd_display_res_set(mode->interlace, mode->horz,
+            VDP2_TVMD_VERT_224);
+        vdp2_tvmd_display_set();
+
+        vdp1_env_default_init(env);
+
+        env->bpp = (mode->bpp == 8) ? VDP1_ENV_BPP_8 : VDP1_ENV_BPP_16;
+        env->erase_points[0].x = 0;
+        env->erase_points[0].y = 0;
+        env->erase_points[1].x = mode->width - 1;
+        env->erase_points[1].y = erase_height - 1;
+
+        vdp1_env_set(env);
+
+        _mode = mode;
+
+        _cmdt_list_coords_set(_fill_cmdt_list, mode);
+        _cmdt_list_coords_set(_change_cmdt_list, mode);
+
+        const int16_vec2_t points[4] = {
+                INT16_VEC2_INITIALIZER(              0, mode->height - 1),
+                INT16_VEC2_INITIALIZER(mode->width - 1, mode->height - 1),
+                INT16_VEC2_INITIALIZER(mode->width - 1,                0),
+                INT16_VEC2_INITIALIZER(              0,                0)
+        };
+
+        for (i = 0; i < FRAMEBUFFER_FILL_COUNT; i++) {
+                vdp1_cmdt_t * const cmdt =
+                    &_fill_cmdt_list->cmdts[ORDER_POLYGON_INDEX + i];
+
+                /* A palette code in 8bpp, a colour otherwise */
+                vdp1_cmdt_polygon_set(cmdt);
+                vdp1_cmdt_param_draw_mode_set(cmdt, draw_mode);
+                vdp1_cmdt_param_color_set(cmdt, (mode->bpp == 8) ?
+                    (0x0010 + i) : COLOR_RGB1555(1, 31, 8 * i, 0));
+                vdp1_cmdt_param_vertices_set(cmdt, &points[0]);
+        }
+
+        /* Let a few fields go by in the new mode */
+        for (i = 0; i < 4; i++) {
+                vdp2_sync();
+                vdp2_sync_wait();
+        }
+}
+
+/* FRT ticks from the start of VBlank until the VDP1 has erased the
+ * window, changed frames and read the end of a list with nothing to draw.
+ *
+ * In the usual 1-cycle mode, the display framebuffer is erased while it is
+ * scanned out, alongside the drawing into the other one, so the erase
+ * hardly shows in the time to the end flag. The erase is moved into VBlank
+ * instead (VBE), with a manual change, so that it runs before the plot */
+uint32_t
+framebuffer_change_ticks_get(void)
+{
+        volatile uint16_t * const tvmr = (volatile uint16_t *)VDP1_TVMR;
+        volatile uint16_t * const fbcr = (volatile uint16_t *)VDP1_FBCR;
+        volatile uint16_t * const ptmr = (volatile uint16_t *)VDP1_PTMR;
+        volatile uint16_t * const edsr = (volatile uint16_t *)VDP1_EDSR;
+
+        const uint16_t tvm = (_mode->bpp == 8) ? VDP1_TVMR_8BPP : 0x0000;
+        const uint16_t die = (_mode->interlace == VDP2_TVMD_INTERLACE_DOUBLE) ?
+            VDP1_FBCR_DIE : 0x0000;
+
+        (void)_draw_ticks_get(_change_cmdt_list);
+
+        *tvmr = tvm | VDP1_TVMR_VBE;
+        *ptmr = VDP1_PTMR_AUTO;
+
+        /* The change is asked for during the display, for the next VBlank */
+        vdp2_tvmd_vblank_out_wait();
+        *fbcr = die | VDP1_FBCR_FCM | VDP1_FBCR_FCT;
+        vdp2_tvmd_vblank_in_wait();
+
+        const uint32_t start = timer_ticks_get();
+        while ((*edsr & VDP1_EDSR_CEF) != 0) {
+        }
+        while ((*edsr & VDP1_EDSR_CEF) == 0) {
+        }
+        const uint32_t ticks = timer_ticks_get() - start;
+
+        *ptmr = VDP1_PTMR_IDLE;
+        *tvmr = tvm;
+
+        /* Back to the change of the environment */
+        vdp1_env_set(&_env);
+
+        return ticks;
+}
+
+/* FRT ticks from the start to the end of VBlank. An erase that does not
+ * end within it is cut short */
+uint32_t
+framebuffer_vblank_ticks_get(void)
+{
+        vdp2_tvmd_vblank_out_wait();
+        vdp2_tvmd_vblank_in_wait();
+
+        const uint32_t start = timer_ticks_get();
+        vdp2_tvmd_vblank_out_wait();
+        const uint32_t ticks = timer_ticks_get() - start;
+
+        return ticks;
+}
+
+/* FRT ticks to draw FRAMEBUFFER_FILL_COUNT full screen polygons */
+uint32_t
+framebuffer_fill_ticks_get(void)
+{
+        return _draw_ticks_get(_fill_cmdt_list);
+}
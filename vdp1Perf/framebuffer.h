@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#ifndef FRAMEBUFFER_H_
+#define FRAMEBUFFER_H_
+
+#include <yaul.h>
+
+#define FRAMEBUFFER_MODE_COUNT          (6)
+
+/* Full screen polygons drawn by a fill measurement */
+#define FRAMEBUFFER_FILL_COUNT          (4)
+
+typedef struct {
+        const char *name;
+        uint8_t horz;           /* VDP2_TVMD_HORZ_* */
+        uint8_t interlace;      /* VDP2_TVMD_INTERLACE_* */
+        uint8_t bpp;
+        uint16_t width;
+        uint16_t height;        /* Lines drawn in one field */
+} framebuffer_mode_t;
+
+extern const framebuffer_mode_t *framebuffer_mode_get(uint32_t mode);
+extern void framebuffer_init(void);
+extern void framebuffer_mode_set(const framebuffer_mode_t *mode,
+    uint16_t erase_height);
+extern uint32_t framebuffer_change_ticks_get(void);
+extern uint32_t framebuffer_vblank_ticks_get(void);
+extern uint32_t framebuffer_fill_ticks_get(void);
+
+#endif /* !FRAMEBUFFER_H_ */
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#include <yaul.h>
+
+#include "gouraud.h"
+
+static vdp1_gouraud_table_t *_base = NULL;
+static uint32_t _count = 0;
+
+/* Stack of the indices of the free tables */
+static uint16_t _free[GOURAUD_COUNT_MAX];
+static uint32_t _free_count = 0;
+
+void
+gouraud_init(vdp1_gouraud_table_t *base, uint32_t count)
+{
+        uint32_t i;
+
+        if (count > GOURAUD_COUNT_MAX) {
+                count = GOURAUD_COUNT_MAX;
+        }
+
+        _base = base;
+        _count = count;
+
+        /* The first table is handed out first */
+        for (i = 0; i < count; i++) {
+                _free[i] = count - 1 - i;
+        }
+
+        _free_count = count;
+}
+
+/* Returns NULL once every table is in use */
+vdp1_gouraud_table_t *
+gouraud_alloc(void)
+{
+        if (_free_count == 0) {
+                return NULL;
+        }
+
+        _free_count--;
+
+        return &_base[_free[_free_count]];
+}
+
+void
+gouraud_free(vdp1_gouraud_table_t *table)
+{
+        if ((table == NULL) || (table < _base) || (table >= &_base[_count]) ||
+            (_free_count == _count)) {
+                return;
+        }
+
+        _free[_free_count] = table - _base;
+        _free_count++;
+}
+
+uint32_t
+gouraud_free_count_get(void)
+{
+        return _free_count;
+}
@@ -0,0 +1,24 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#ifndef GOURAUD_H_
+#define GOURAUD_H_
+
+#include <yaul.h>
+
+/* Tables in the gouraud partition */
+#define GOURAUD_COUNT_MAX       (4096)
+
+/* Tables of the gouraud partition are handed out and taken back in
+ * constant time, most recently freed first */
+
+extern void gouraud_init(vdp1_gouraud_table_t *base, uint32_t count);
+extern vdp1_gouraud_table_t *gouraud_alloc(void);
+extern void gouraud_free(vdp1_gouraud_table_t *table);
+extern uint32_t gouraud_free_count_get(void);
+
+#endif /* !GOURAUD_H_ */
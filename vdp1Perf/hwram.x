@@ -0,0 +1,6 @@
+/* Added to the link of Vdp1Perf. The program, its data and its BSS share
+ * HWRAM with the heap, which holds both command lists (2 x 2051 commands,
+ * about 128 KB) and the buffers of libyaul. Fails the link when less than
+ * 256 KB of HWRAM are left to it */
+ASSERT((ADDR(.bss) + SIZEOF(.bss)) <= (0x06100000 - 0x40000),
+    "Vdp1Perf: less than 256 KB of HWRAM left for the heap");
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#include <yaul.h>
+
+#include "profile.h"
+#include "timer.h"
+
+/* Sample the current command until the VDP1 reaches end_index. Only the
+ * changes of command are kept */
+void
+profile_run(profile_t *profile, uint16_t end_index)
+{
+        profile_step_t *step = NULL;
+        uint32_t samples = 0;
+        uint32_t now;
+        uint16_t index;
+
+        profile->count = 0;
+
+        const uint32_t start = timer_ticks_get();
+
+        do {
+                index = vdp1_cmdt_current_get();
+                now = timer_ticks_get() - start;
+
+                samples++;
+
+                if ((step != NULL) && (step->index == index)) {
+                        continue;
+                }
+
+                if (step != NULL) {
+                        step->ticks = now - step->start;
+                        step = NULL;
+                }
+
+                if ((index == end_index) || (profile->count == PROFILE_STEPS_MAX)) {
+                        continue;
+                }
+
+                step = &profile->steps[profile->count];
+
+                profile->count++;
+
+                step->index = index;
+                step->start = now;
+                step->ticks = 0;
+        } while (index != end_index);
+
+        profile->samples = samples;
+        profile->total = now;
+}
+
+/* Fill steps with up to count of the longest steps, longest first. Returns
+ * how many were found */
+uint32_t
+profile_slowest_get(const profile_t *profile, const profile_step_t **steps,
+    uint32_t count)
+{
+        uint32_t found = 0;
+        uint32_t i;
+
+        if (count == 0) {
+                return 0;
+        }
+
+        for (i = 0; i < profile->count; i++) {
+                const profile_step_t * const step = &profile->steps[i];
+
+                if ((found == count) && (step->ticks <= steps[found - 1]->ticks)) {
+                        continue;
+                }
+
+                uint32_t j = (found < count) ? found++ : (found - 1);
+
+                for (; (j > 0) && (steps[j - 1]->ticks < step->ticks); j--) {
+                        steps[j] = steps[j - 1];
+                }
+
+                steps[j] = step;
+        }
+
+        return found;
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include <yaul.h>
+
+/* One more than the longest command list */
+#define PROFILE_STEPS_MAX       (2052)
+
+/* A command seen as the current one by the VDP1, from start until the next
+ * command was seen. Commands drawn faster than one sample are not seen at
+ * all, and their time is counted in the step before them */
+typedef struct {
+        uint16_t index;
+        uint32_t start;         /* FRT ticks since the first sample */
+        uint32_t ticks;
+} profile_step_t;
+
+typedef struct {
+        uint32_t count;
+        uint32_t samples;       /* Register reads made while drawing */
+        uint32_t total;         /* FRT ticks until the end command */
+        profile_step_t steps[PROFILE_STEPS_MAX];
+} profile_t;
+
+extern void profile_run(profile_t *profile, uint16_t end_index);
+extern uint32_t profile_slowest_get(const profile_t *profile,
+    const profile_step_t **steps, uint32_t count);
+
+#endif /* !PROFILE_H_ */
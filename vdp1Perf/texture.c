@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#include <yaul.h>
+
+#include "texture.h"
+
+/* The asset is 8bpp with a 256 colour RGB1555 palette. The other colour
+ * modes are derived from it at boot */
+extern uint8_t asset_zoom_tex[];
+extern uint8_t asset_zoom_pal[];
+
+#define TEXTURE_TEXELS          (TEXTURE_WIDTH * TEXTURE_HEIGHT)
+
+/* The 8bpp texture reads its colours from CRAM, above the debug console */
+#define TEXTURE_COLOR_BANK      (0x0100)
+#define TEXTURE_CRAM_ADDR       (0x25F00000 + (TEXTURE_COLOR_BANK << 1))
+
+/* Lookup table entries of the 4bpp texture */
+#define TEXTURE_CLUT_COUNT      (16)
+
+static texture_t _textures[TEXTURE_COLOR_MODE_COUNT] = {
+        {
+                .name = "4BPP",
+                .color_mode = 1
+        },
+        {
+                .name = "8BPP",
+                .color_mode = 4
+        },
+        {
+                .name = "RGB",
+                .color_mode = 5
+        }
+};
+
+/* Only the fetch pattern matters, so the 4bpp texture simply splits the
+ * palette into 15 equal runs. Index 0 stays transparent in every mode */
+static inline uint8_t
+_texel_4bpp_get(uint8_t texel)
+{
+        if (texel == 0) {
+                return 0;
+        }
+
+        return 1 + (((texel - 1) * (TEXTURE_CLUT_COUNT - 1)) / 255);
+}
+
+void
+texture_init(const vdp1_vram_partitions_t *partitions)
+{
+        const uint16_t * const palette = (const uint16_t *)asset_zoom_pal;
+        uint32_t i;
+
+        const uint32_t base = (uint32_t)partitions->texture_base;
+
+        texture_t * const texture_4bpp = &_textures[TEXTURE_COLOR_MODE_4BPP];
+        texture_t * const texture_8bpp = &_textures[TEXTURE_COLOR_MODE_8BPP];
+        texture_t * const texture_rgb = &_textures[TEXTURE_COLOR_MODE_RGB];
+
+        texture_4bpp->char_base = base;
+        texture_8bpp->char_base = texture_4bpp->char_base + (TEXTURE_TEXELS / 2);
+        texture_rgb->char_base = texture_8bpp->char_base + TEXTURE_TEXELS;
+
+        volatile uint8_t * const texels_4bpp = (volatile uint8_t *)texture_4bpp->char_base;
+        volatile uint8_t * const texels_8bpp = (volatile uint8_t *)texture_8bpp->char_base;
+        volatile uint16_t * const texels_rgb = (volatile uint16_t *)texture_rgb->char_base;
+
+        for (i = 0; i < TEXTURE_TEXELS; i += 2) {
+                const uint8_t t0 = asset_zoom_tex[i];
+                const uint8_t t1 = asset_zoom_tex[i + 1];
+
+                texels_4bpp[i >> 1] = (_texel_4bpp_get(t0) << 4) | _texel_4bpp_get(t1);
+
+                texels_8bpp[i] = t0;
+                texels_8bpp[i + 1] = t1;
+
+                texels_rgb[i] = (t0 == 0) ? 0x0000 : (palette[t0] | 0x8000);
+                texels_rgb[i + 1] = (t1 == 0) ? 0x0000 : (palette[t1] | 0x8000);
+        }
+
+        /* Each run of the palette is shown by its first colour */
+        volatile uint16_t * const clut = (volatile uint16_t *)partitions->clut_base;
+
+        clut[0] = 0x0000;
+
+        for (i = 1; i < TEXTURE_CLUT_COUNT; i++) {
+                clut[i] = palette[1 + (((i - 1) * 255) / (TEXTURE_CLUT_COUNT - 1))] | 0x8000;
+        }
+
+        texture_4bpp->colr = ((uint32_t)partitions->clut_base - VDP1_VRAM(0)) >> 3;
+
+        volatile uint16_t * const cram = (volatile uint16_t *)TEXTURE_CRAM_ADDR;
+
+        for (i = 0; i < 256; i++) {
+                cram[i] = palette[i];
+        }
+
+        texture_8bpp->colr = TEXTURE_COLOR_BANK;
+        texture_rgb->colr = 0x0000;
+}
+
+const texture_t *
+texture_get(uint32_t color_mode)
+{
+        return &_textures[color_mode];
+}
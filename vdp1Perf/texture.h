@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#ifndef TEXTURE_H_
+#define TEXTURE_H_
+
+#include <yaul.h>
+
+/* First frame of the ZOOM.TEX asset shared with Vdp1Drawing */
+#define TEXTURE_WIDTH           (64)
+#define TEXTURE_HEIGHT          (102)
+
+#define TEXTURE_COLOR_MODE_4BPP 0 /* 16 colour lookup table */
+#define TEXTURE_COLOR_MODE_8BPP 1 /* 256 colour bank */
+#define TEXTURE_COLOR_MODE_RGB  2
+#define TEXTURE_COLOR_MODE_COUNT 3
+
+typedef struct {
+        const char *name;
+        uint32_t char_base;     /* VDP1 VRAM address of the texels */
+        uint16_t colr;          /* Lookup table address or colour bank */
+        uint8_t color_mode;     /* Colour mode of the draw mode */
+} texture_t;
+
+extern void texture_init(const vdp1_vram_partitions_t *partitions);
+extern const texture_t *texture_get(uint32_t color_mode);
+
+#endif /* !TEXTURE_H_ */
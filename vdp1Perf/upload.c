@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#include <yaul.h>
+
+#include "scudma.h"
+#include "timer.h"
+#include "upload.h"
+
+/* Commands moved by each transfer of the indirect table, as if the list
+ * was gathered from one buffer per object */
+#define UPLOAD_BLOCK_COUNT      (64)
+#define UPLOAD_XFER_COUNT_MAX   (UPLOAD_COUNT_MAX / UPLOAD_BLOCK_COUNT)
+
+/* Only the amount of data matters, not what the commands draw, so the
+ * commands are read from the start of HWRAM rather than from a table as
+ * large as VDP1 VRAM. The SCU cannot read LWRAM */
+#define UPLOAD_SOURCE           (0x06000000UL)
+
+static const char * const _method_names[UPLOAD_METHOD_COUNT] = {
+        "CPU",
+        "SCU direct",
+        "SCU indirect"
+};
+
+/* The SCU wants the table aligned on its size rounded up to a power of
+ * two */
+static scu_dma_xfer_t _xfers[UPLOAD_XFER_COUNT_MAX] __aligned(4096);
+
+static scu_dma_handle_t _scu_handle;
+
+static void
+_cpu_copy(uint32_t count)
+{
+        const uint32_t *s = (const uint32_t *)UPLOAD_SOURCE;
+        volatile uint32_t *d = (volatile uint32_t *)VDP1_VRAM(0);
+        uint32_t i;
+
+        for (i = 0; i < count; i++, s += 8, d += 8) {
+                d[0] = s[0];
+                d[1] = s[1];
+                d[2] = s[2];
+                d[3] = s[3];
+                d[4] = s[4];
+                d[5] = s[5];
+                d[6] = s[6];
+                d[7] = s[7];
+        }
+}
+
+static void
+_scu_dma(const scu_dma_level_cfg_t *cfg)
+{
+        scudma_config_set(&_scu_handle, cfg);
+        scudma_start();
+        scudma_wait();
+}
+
+/* The table is part of building a list, so it is not timed */
+static void
+_xfers_init(uint32_t count)
+{
+        uint32_t i;
+
+        for (i = 0; (i * UPLOAD_BLOCK_COUNT) < count; i++) {
+                const uint32_t first = i * UPLOAD_BLOCK_COUNT;
+                const uint32_t left = count - first;
+                const uint32_t block = (left < UPLOAD_BLOCK_COUNT) ? left : UPLOAD_BLOCK_COUNT;
+
+                _xfers[i].len = block * sizeof(vdp1_cmdt_t);
+                _xfers[i].dst = VDP1_VRAM(first * sizeof(vdp1_cmdt_t));
+                _xfers[i].src = UPLOAD_SOURCE + (first * sizeof(vdp1_cmdt_t));
+        }
+
+        _xfers[i - 1].src |= SCU_DMA_INDIRECT_TABLE_END;
+}
+
+const char *
+upload_method_name_get(uint32_t method)
+{
+        return _method_names[method];
+}
+
+/* FRT ticks to write the first count commands of VDP1 VRAM. The VDP1 must
+ * not be drawing, and whatever VDP1 VRAM held is lost */
+uint32_t
+upload_ticks_get(uint32_t method, uint32_t count)
+{
+        scu_dma_level_cfg_t cfg = {
+                .stride = SCU_DMA_STRIDE_2_BYTES,
+                .update = SCU_DMA_UPDATE_NONE
+        };
+
+        if (count == 0) {
+                return 0;
+        }
+
+        if (count > UPLOAD_COUNT_MAX) {
+                count = UPLOAD_COUNT_MAX;
+        }
+
+        if (method == UPLOAD_METHOD_SCU_DIRECT) {
+                cfg.mode = SCU_DMA_MODE_DIRECT;
+                cfg.xfer.direct.len = count * sizeof(vdp1_cmdt_t);
+                cfg.xfer.direct.dst = VDP1_VRAM(0);
+                cfg.xfer.direct.src = UPLOAD_SOURCE;
+        } else if (method == UPLOAD_METHOD_SCU_INDIRECT) {
+                _xfers_init(count);
+
+                cfg.mode = SCU_DMA_MODE_INDIRECT;
+                cfg.xfer.indirect = &_xfers[0];
+        }
+
+        const uint32_t start = timer_ticks_get();
+
+        if (method == UPLOAD_METHOD_CPU) {
+                _cpu_copy(count);
+        } else {
+                _scu_dma(&cfg);
+        }
+
+        return timer_ticks_get() - start;
+}
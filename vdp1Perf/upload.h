@@ -0,0 +1,24 @@
+/*
+ * Copyright (c) 2012-2017 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#ifndef UPLOAD_H_
+#define UPLOAD_H_
+
+#include <yaul.h>
+
+#define UPLOAD_METHOD_CPU               0 /* Longword copy */
+#define UPLOAD_METHOD_SCU_DIRECT        1
+#define UPLOAD_METHOD_SCU_INDIRECT      2 /* One transfer per block of commands */
+#define UPLOAD_METHOD_COUNT             3
+
+/* Commands filling the whole VDP1 VRAM */
+#define UPLOAD_COUNT_MAX                (16384)
+
+extern const char *upload_method_name_get(uint32_t method);
+extern uint32_t upload_ticks_get(uint32_t method, uint32_t count);
+
+#endif /* !UPLOAD_H_ */
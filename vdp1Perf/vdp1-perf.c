@@ -10,6 +10,17 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "harness.h"
+#include "profile.h"
+#include "report.h"
+#include "clipping.h"
+#include "decompress.h"
+#include "framebuffer.h"
+#include "gouraud.h"
+#include "texture.h"
+#include "upload.h"
+#include "timer.h"
+
 #define SCREEN_WIDTH    320
 #define SCREEN_HEIGHT   224
 
@@ -21,7 +32,12 @@
 
 #define PRIMITIVE_TYPE_POLYLINE   (0)
 #define PRIMITIVE_TYPE_POLYGON    (1)
-#define PRIMITIVE_TYPE_COUNT      (2)
+#define PRIMITIVE_TYPE_NORMAL_SPRITE    (2)
+#define PRIMITIVE_TYPE_SCALED_SPRITE    (3)
+#define PRIMITIVE_TYPE_DISTORTED_SPRITE (4)
+#define PRIMITIVE_TYPE_COUNT      (5)
+
+#define PRIMITIVE_TYPE_SPRITE(t)  ((t) >= PRIMITIVE_TYPE_NORMAL_SPRITE)
 
 #define PRIMITIVE_DRAW_MODE_NORMAL                (0)
 #define PRIMITIVE_DRAW_MODE_MESH                  (1)
@@ -33,33 +49,104 @@
 #define PRIMITIVE_DRAW_MODE_GOURAUD_HALF_TRANS    (7)
 #define PRIMITIVE_DRAW_MODE_COUNT                 (8)
 
-#define PRIMITIVE_WIDTH           64
-#define PRIMITIVE_HEIGHT          64
-#define PRIMITIVE_HALF_WIDTH      (PRIMITIVE_WIDTH / 2)
-#define PRIMITIVE_HALF_HEIGHT     (PRIMITIVE_HEIGHT / 2)
+#define PRIMITIVE_DRAW_MODE_GOURAUD(m)  ((m) >= PRIMITIVE_DRAW_MODE_GOURAUD_SHADING)
+
+/* Gouraud polygons share the first table or each use their own */
+#define PRIMITIVE_GOURAUD_SHARED  (0)
+#define PRIMITIVE_GOURAUD_OWN     (1)
 
 #define PRIMITIVE_COLOR           COLOR_RGB1555(1, 31, 0, 31)
 
-#define MS_VALUE (CPU_FRT_PAL_320_8_COUNT_1MS)
+#define CPU_FRT_INTERRUPT_PRIORITY_LEVEL 8
+
+/* The console is redrawn at this rate rather than every frame */
+#define CONSOLE_REFRESH_MS      (250)
+
+/* Primitives are drawn in counts of 1 up to SWEEP_COUNT_MAX, doubling */
+#define SWEEP_COUNT_MAX         (2048)
+#define SWEEP_COUNT_STEPS       (12)
+#define SWEEP_SIZE_STEPS        (4)
+/* Sprites sweep zoom factors instead of sizes */
+#define SWEEP_ZOOM_STEPS        (5)
+#define SWEEP_ZOOM_1X           (2)
+
+/* Frames discarded before, and frames kept for, the statistics */
+#define TIMING_WARMUP           (1)
+#define TIMING_REPETITIONS      (7)
 
-#define NB_CMD (1<<8)
+/* After its statistics, one more frame of each configuration is profiled.
+ * Short lists stream their whole timeline, longer ones their slowest
+ * commands */
+#define PROFILE_TIMELINE_COUNT_MAX      (64)
+#define PROFILE_SLOWEST_COUNT           (8)
+
+/* Then frames whose list is rebuilt every frame are timed, serially and
+ * pipelined. Pipelined, the next list is built in the other buffer while
+ * the VDP1 draws */
+#define PIPELINE_MODE_SERIAL            0
+#define PIPELINE_MODE_PIPELINED         1
+#define PIPELINE_MODE_COUNT             2
+#define PIPELINE_BUFFER_COUNT           2
+
+/* Each pass starts by timing the upload of lists of these sizes, with the
+ * usual sizes of a game scene in the middle */
+#define UPLOAD_COUNT_STEPS              (12)
+
+/* Then the erase of a window of every framebuffer mode, a fraction of the
+ * screen high, and the fill rate of full screen polygons */
+#define ERASE_AREA_COUNT                (4)
 
 #define ORDER_SYSTEM_CLIP_COORDS_INDEX  0
 #define ORDER_LOCAL_COORDS_INDEX        1
-#define ORDER_POLYGON_INDEX             2
-#define ORDER_DRAW_END_INDEX            (NB_CMD+ORDER_POLYGON_INDEX)
-#define ORDER_COUNT                     (ORDER_DRAW_END_INDEX+1)
+#define ORDER_PRIMITIVE_INDEX           2
+#define ORDER_COUNT_MAX                 (ORDER_PRIMITIVE_INDEX + SWEEP_COUNT_MAX + 1)
 
-static vdp1_cmdt_list_t *_cmdt_list = NULL;
+static vdp1_cmdt_list_t *_cmdt_lists[PIPELINE_BUFFER_COUNT];
 static vdp1_vram_partitions_t _vdp1_vram_partitions;
 
+/* Configuration being measured. A count of zero draws nothing and gives the
+ * fixed cost subtracted from every other measurement */
 static struct {
         int8_t type;
         int8_t draw_mode;
+        uint8_t size_step;
+        uint8_t color_mode;
+        uint8_t gouraud;
+        int8_t count_step;
+        uint16_t count;
+        uint16_t width;
+        uint16_t height;
+        uint16_t texels;        /* Read by a sprite */
         color_rgb1555_t color;
         int16_vec2_t points[4];
 } _primitive;
 
+/* Side of the square primitive, in pixels */
+static const uint16_t _primitive_sizes[SWEEP_SIZE_STEPS] = {
+        8,
+        32,
+        64,
+        128
+};
+
+/* Zoom factors in quarters. Above 1x, fewer lines of the texture are drawn
+ * so that the sprite stays on screen */
+static const uint8_t _sprite_zooms[SWEEP_ZOOM_STEPS] = {
+        1,
+        2,
+        4,
+        8,
+        16
+};
+
+static const char *_sprite_zoom_strings[SWEEP_ZOOM_STEPS] = {
+        "0.25x",
+        "0.5x",
+        "1x",
+        "2x",
+        "4x"
+};
+
 static vdp1_cmdt_draw_mode_t _primitive_draw_modes[] = {
         {
                 .raw = 0x0000
@@ -94,52 +181,853 @@ static vdp1_cmdt_draw_mode_t _primitive_draw_modes[] = {
         }
 };
 
-// static char *_primitive_type_strings[] = {
-//         "POLYLINE",
-//         "POLYGON"
-// };
-//
-// static char *_primitive_draw_mode_strings[] = {
-//         "NORMAL",
-//         "MESH",
-//         "SHADOW",
-//         "HALF-LUMINANCE",
-//         "REPLACE/HALF-TRANSPARENT",
-//         "GOURAUD",
-//         "GOURAUD+HALF-LUMINANCE",
-//         "GOURAUD+HALF-TRANSPARENT"
-// };
+static const char *_primitive_type_strings[] = {
+        "POLYLINE",
+        "POLYGON",
+        "NORMAL SPRITE",
+        "SCALED SPRITE",
+        "DISTORTED SPRITE"
+};
+
+static const char *_primitive_draw_mode_strings[] = {
+        "NORMAL",
+        "MESH",
+        "SHADOW",
+        "HALF-LUMINANCE",
+        "REPLACE/HALF-TRANSPARENT",
+        "GOURAUD",
+        "GOURAUD+HALF-LUMINANCE",
+        "GOURAUD+HALF-TRANSPARENT"
+};
 
+static const uint16_t _upload_counts[UPLOAD_COUNT_STEPS] = {
+        16,
+        64,
+        256,
+        300,
+        600,
+        900,
+        1200,
+        1500,
+        2048,
+        4096,
+        8192,
+        UPLOAD_COUNT_MAX
+};
+
+static const uint8_t _erase_divisors[ERASE_AREA_COUNT] = {
+        16,
+        4,
+        2,
+        1
+};
+
+static void _display_init(void);
 static void _cmdt_list_init(void);
-static void _primitive_init(void);
+static void _gouraud_table_init(void);
+static void _primitive_init(vdp1_cmdt_list_t *);
+
+static harness_t _harness;
+static harness_stats_t _harness_stats;
+
+/* Fixed cost of a frame, in FRT ticks */
+static uint32_t _empty_ticks = 0;
+
+/* Median FRT ticks for each count of the current type, mode and size */
+static uint32_t _sweep_ticks[SWEEP_COUNT_STEPS];
+
+/* Median FRT ticks of the flat polygons of the current type, to which the
+ * gouraud modes are compared */
+static uint32_t _flat_ticks[SWEEP_SIZE_STEPS][SWEEP_COUNT_STEPS];
+
+/* Tables of the polygons that use their own */
+static vdp1_gouraud_table_t *_gouraud_tables[SWEEP_COUNT_MAX];
+static uint32_t _gouraud_table_count = 0;
+
+static profile_t _profile;
+static const profile_step_t *_profile_slowest[PROFILE_SLOWEST_COUNT];
+static uint32_t _profile_slowest_count = 0;
+
+static const char *_pipeline_mode_strings[] = {
+        "serial",
+        "pipelined"
+};
+
+/* Median frame rate of each pipeline mode, in hundredths of frames per
+ * second */
+static uint32_t _pipeline_fps100[PIPELINE_MODE_COUNT];
+
+static volatile bool _console_refresh = false;
+
+static void
+_console_timer_handler(struct timer *timer __unused)
+{
+        _console_refresh = true;
+}
+
+/* Pixels written by one primitive */
+static uint32_t
+_primitive_pixels_get(void)
+{
+        if (_primitive.type == PRIMITIVE_TYPE_POLYLINE) {
+                return 2 * ((_primitive.width - 1) + (_primitive.height - 1));
+        }
+
+        return _primitive.width * _primitive.height;
+}
+
+/* Hundredths of microseconds */
+static uint32_t
+_ticks_us100(uint32_t ticks)
+{
+        return timer_ticks_us100(ticks);
+}
+
+/* Hundredths of units per millisecond */
+static uint32_t
+_rate100(uint64_t units, uint32_t ticks)
+{
+        uint64_t ns = timer_ticks_ns(ticks);
+
+        if (ns == 0) {
+                ns = 1;
+        }
+
+        const uint64_t rate = (units * 100000000ULL) / ns;
+
+        return (rate > UINT32_MAX) ? UINT32_MAX : (uint32_t)rate;
+}
+
+static uint32_t
+_ticks_less_us100(uint32_t ticks, uint32_t less)
+{
+        return _ticks_us100((ticks > less) ? (ticks - less) : 0);
+}
+
+/* Hundredths of percent that ticks exceed base by */
+static uint32_t
+_overhead100(uint32_t ticks, uint32_t base)
+{
+        if (ticks <= base) {
+                return 0;
+        }
+
+        return (uint32_t)(((uint64_t)(ticks - base) * 10000) / base);
+}
+
+/* Turn statistics in ticks into statistics in hundredths of microseconds,
+ * less a fixed number of ticks */
+static void
+_stats_us_get(const harness_stats_t *ticks, uint32_t less,
+    harness_stats_t *us)
+{
+        *us = *ticks;
+
+        us->min = _ticks_less_us100(ticks->min, less);
+        us->median = _ticks_less_us100(ticks->median, less);
+        us->max = _ticks_less_us100(ticks->max, less);
+        us->mean = _ticks_less_us100(ticks->mean, less);
+        us->stddev = _ticks_us100(ticks->stddev);
+}
+
+/* Turn statistics in ticks into statistics of a rate. The spread is only
+ * carried to first order */
+static void
+_stats_rate_get(const harness_stats_t *ticks, uint64_t units,
+    harness_stats_t *rate)
+{
+        *rate = *ticks;
+
+        rate->min = _rate100(units, ticks->max);
+        rate->median = _rate100(units, ticks->median);
+        rate->max = _rate100(units, ticks->min);
+        rate->mean = _rate100(units, ticks->mean);
+        rate->stddev = (ticks->median == 0) ? 0 :
+            (uint32_t)(((uint64_t)rate->median * ticks->stddev) / ticks->median);
+}
+
+/* Hundredths of units per CPU cycle */
+static uint32_t
+_per_cycle100(uint64_t units, uint32_t ticks)
+{
+        const uint64_t cycles = (ticks == 0) ? 1 : ((uint64_t)ticks * TIMER_CLOCK_DIV);
+
+        return (uint32_t)((units * 100) / cycles);
+}
+
+/* Same as _stats_rate_get, per CPU cycle and less a fixed number of
+ * ticks */
+static void
+_stats_per_cycle_get(const harness_stats_t *ticks, uint32_t less,
+    uint64_t units, harness_stats_t *rate)
+{
+        const uint32_t median = (ticks->median > less) ? (ticks->median - less) : 0;
+
+        *rate = *ticks;
+
+        rate->min = _per_cycle100(units, (ticks->max > less) ? (ticks->max - less) : 0);
+        rate->median = _per_cycle100(units, median);
+        rate->max = _per_cycle100(units, (ticks->min > less) ? (ticks->min - less) : 0);
+        rate->mean = _per_cycle100(units, (ticks->mean > less) ? (ticks->mean - less) : 0);
+        rate->stddev = (median == 0) ? 0 :
+            (uint32_t)(((uint64_t)rate->median * ticks->stddev) / median);
+}
+
+static void
+_primitive_name_get(char *name, size_t name_size, char *variant,
+    size_t variant_size)
+{
+        if (_primitive.count == 0) {
+                (void)snprintf(name, name_size, "empty");
+        } else if (PRIMITIVE_TYPE_SPRITE(_primitive.type)) {
+                (void)snprintf(name, name_size, "%s %s %s",
+                    _primitive_type_strings[_primitive.type],
+                    texture_get(_primitive.color_mode)->name,
+                    _sprite_zoom_strings[_primitive.size_step]);
+        } else {
+                (void)snprintf(name, name_size, "%s %s %u%s",
+                    _primitive_type_strings[_primitive.type],
+                    _primitive_draw_mode_strings[_primitive.draw_mode],
+                    _primitive.width,
+                    (_primitive.gouraud == PRIMITIVE_GOURAUD_OWN) ? " own tables" : "");
+        }
+
+        (void)snprintf(variant, variant_size, "x%u", _primitive.count);
+}
+
+/* Stream the last statistics as a draw time and as throughputs */
+static void
+_timing_report(void)
+{
+        harness_stats_t stats;
+        char name[48];
+        char variant[8];
+
+        _primitive_name_get(name, sizeof(name), variant, sizeof(variant));
+
+        _stats_us_get(&_harness_stats, 0, &stats);
+
+        report_stats(name, variant, "us", &stats);
+
+        if (_primitive.count == 0) {
+                return;
+        }
+
+        _stats_rate_get(&_harness_stats, (uint64_t)_primitive.count * 1000, &stats);
+        report_stats(name, variant, "cmd/s", &stats);
+
+        _stats_rate_get(&_harness_stats,
+            (uint64_t)_primitive.count * _primitive_pixels_get(), &stats);
+        report_stats(name, variant, "kpx/s", &stats);
+
+        if (!PRIMITIVE_TYPE_SPRITE(_primitive.type)) {
+                return;
+        }
+
+        _stats_rate_get(&_harness_stats,
+            (uint64_t)_primitive.count * _primitive.texels, &stats);
+        report_stats(name, variant, "ktx/s", &stats);
+}
+
+/* Stream the extra draw time of a gouraud mode over flat polygons of the
+ * same size and count, in percent */
+static void
+_gouraud_report(void)
+{
+        harness_stats_t stats;
+        char name[48];
+        char variant[8];
+
+        if (PRIMITIVE_TYPE_SPRITE(_primitive.type) || (_primitive.count == 0)) {
+                return;
+        }
+
+        if (_primitive.draw_mode == PRIMITIVE_DRAW_MODE_NORMAL) {
+                _flat_ticks[_primitive.size_step][_primitive.count_step] =
+                    _harness_stats.median;
+
+                return;
+        }
+
+        const uint32_t flat = _flat_ticks[_primitive.size_step][_primitive.count_step];
+
+        if (!PRIMITIVE_DRAW_MODE_GOURAUD(_primitive.draw_mode) || (flat == 0)) {
+                return;
+        }
+
+        _primitive_name_get(name, sizeof(name), variant, sizeof(variant));
+
+        stats = _harness_stats;
+        stats.min = _overhead100(_harness_stats.min, flat);
+        stats.median = _overhead100(_harness_stats.median, flat);
+        stats.max = _overhead100(_harness_stats.max, flat);
+        stats.mean = _overhead100(_harness_stats.mean, flat);
+        stats.stddev = (uint32_t)(((uint64_t)_harness_stats.stddev * 10000) / flat);
+
+        report_stats(name, variant, "% over flat", &stats);
+}
+
+static void
+_profile_report(void)
+{
+        char name[48];
+        char variant[8];
+        uint32_t i;
+
+        _primitive_name_get(name, sizeof(name), variant, sizeof(variant));
+
+        if (_primitive.count <= PROFILE_TIMELINE_COUNT_MAX) {
+                for (i = 0; i < _profile.count; i++) {
+                        const profile_step_t * const step = &_profile.steps[i];
+
+                        report_timeline(name, variant, step->index,
+                            _ticks_us100(step->start), _ticks_us100(step->ticks));
+                }
+
+                return;
+        }
+
+        for (i = 0; i < _profile_slowest_count; i++) {
+                const profile_step_t * const step = _profile_slowest[i];
+
+                report_timeline(name, variant, step->index,
+                    _ticks_us100(step->start), _ticks_us100(step->ticks));
+        }
+}
+
+/* Polygons sweep sizes and draw modes. Sprites sweep zoom factors and
+ * colour modes, and are only drawn in the normal draw mode. A normal sprite
+ * cannot be zoomed */
+static uint8_t
+_sweep_size_step_first(void)
+{
+        return (_primitive.type == PRIMITIVE_TYPE_NORMAL_SPRITE) ? SWEEP_ZOOM_1X : 0;
+}
+
+static uint8_t
+_sweep_size_step_last(void)
+{
+        if (!PRIMITIVE_TYPE_SPRITE(_primitive.type)) {
+                return SWEEP_SIZE_STEPS - 1;
+        }
+
+        if (_primitive.type == PRIMITIVE_TYPE_NORMAL_SPRITE) {
+                return SWEEP_ZOOM_1X;
+        }
+
+        return SWEEP_ZOOM_STEPS - 1;
+}
+
+static uint8_t
+_sweep_color_mode_last(void)
+{
+        return PRIMITIVE_TYPE_SPRITE(_primitive.type) ? (TEXTURE_COLOR_MODE_COUNT - 1) : 0;
+}
+
+static uint8_t
+_sweep_gouraud_last(void)
+{
+        return (!PRIMITIVE_TYPE_SPRITE(_primitive.type) &&
+                PRIMITIVE_DRAW_MODE_GOURAUD(_primitive.draw_mode)) ?
+            PRIMITIVE_GOURAUD_OWN : PRIMITIVE_GOURAUD_SHARED;
+}
+
+static int8_t
+_sweep_draw_mode_last(void)
+{
+        return PRIMITIVE_TYPE_SPRITE(_primitive.type) ?
+            PRIMITIVE_DRAW_MODE_NORMAL : (PRIMITIVE_DRAW_MODE_COUNT - 1);
+}
+
+/* Move to the next configuration, counts first. Returns true when the
+ * sweep starts over */
+static bool
+_sweep_next(void)
+{
+        if (_primitive.count_step < (SWEEP_COUNT_STEPS - 1)) {
+                _primitive.count_step++;
+
+                return false;
+        }
+
+        _primitive.count_step = 0;
+
+        if (_primitive.size_step < _sweep_size_step_last()) {
+                _primitive.size_step++;
+
+                return false;
+        }
+
+        _primitive.size_step = _sweep_size_step_first();
+
+        if (_primitive.color_mode < _sweep_color_mode_last()) {
+                _primitive.color_mode++;
+
+                return false;
+        }
+
+        _primitive.color_mode = TEXTURE_COLOR_MODE_4BPP;
+
+        if (_primitive.gouraud < _sweep_gouraud_last()) {
+                _primitive.gouraud++;
+
+                return false;
+        }
+
+        _primitive.gouraud = PRIMITIVE_GOURAUD_SHARED;
+
+        if (_primitive.draw_mode < _sweep_draw_mode_last()) {
+                _primitive.draw_mode++;
+
+                return false;
+        }
+
+        _primitive.draw_mode = PRIMITIVE_DRAW_MODE_NORMAL;
+
+        if (_primitive.type < (PRIMITIVE_TYPE_COUNT - 1)) {
+                _primitive.type++;
+                _primitive.size_step = _sweep_size_step_first();
+
+                return false;
+        }
+
+        _primitive.type = PRIMITIVE_TYPE_POLYLINE;
+        _primitive.size_step = _sweep_size_step_first();
+
+        /* The fixed cost is measured again at the start of every pass */
+        _primitive.count_step = -1;
+
+        return true;
+}
+
+static void
+_sweep_print(void)
+{
+        uint32_t i;
+
+        dbgio_puts("[1;1H[2J");
+
+        if (_primitive.count == 0) {
+                dbgio_printf("\n""Measuring fixed cost\n");
+
+                return;
+        }
+
+        dbgio_printf("\n""%s %s %ux%u\n"
+                     "empty %lu us\n\n"
+                     "count       us     cmd/s     kpx/s\n",
+                     _primitive_type_strings[_primitive.type],
+                     PRIMITIVE_TYPE_SPRITE(_primitive.type) ?
+                         texture_get(_primitive.color_mode)->name :
+                         _primitive_draw_mode_strings[_primitive.draw_mode],
+                     _primitive.width,
+                     _primitive.height,
+                     _ticks_us100(_empty_ticks) / 100);
+
+        for (i = 0; i < (uint32_t)_primitive.count_step; i++) {
+                const uint32_t count = 1 << i;
+                const uint32_t ticks = _sweep_ticks[i];
+
+                dbgio_printf("%5lu %8lu %9lu %9lu\n",
+                             count,
+                             _ticks_us100(ticks) / 100,
+                             _rate100((uint64_t)count * 1000, ticks) / 100,
+                             _rate100((uint64_t)count * _primitive_pixels_get(), ticks) / 100);
+        }
 
-static volatile uint16_t _frt_ovf_count = 0;
+        const uint32_t vblank_us100 =
+            timer_ticks_us100(timer_phase_ticks_get(TIMER_PHASE_VBLANK, TIMER_PHASE_LIST_PUT));
+        const uint32_t put_us100 =
+            timer_ticks_us100(timer_phase_ticks_get(TIMER_PHASE_LIST_PUT, TIMER_PHASE_DRAW_START));
+        const uint32_t draw_us100 =
+            timer_ticks_us100(timer_phase_ticks_get(TIMER_PHASE_DRAW_START, TIMER_PHASE_DRAW_END));
 
+        dbgio_printf("\n""last vblank>put %lu.%02lu us\n"
+                     "put %lu.%02lu us draw %lu.%02lu us\n",
+                     vblank_us100 / 100,
+                     vblank_us100 % 100,
+                     put_us100 / 100,
+                     put_us100 % 100,
+                     draw_us100 / 100,
+                     draw_us100 % 100);
+
+        if (_pipeline_fps100[PIPELINE_MODE_SERIAL] != 0) {
+                const uint32_t serial = _pipeline_fps100[PIPELINE_MODE_SERIAL];
+                const uint32_t pipelined = _pipeline_fps100[PIPELINE_MODE_PIPELINED];
+
+                dbgio_printf("\n""last fps %lu serial %lu pipelined\n",
+                             serial / 100,
+                             pipelined / 100);
+        }
+
+        if (_profile_slowest_count == 0) {
+                return;
+        }
+
+        const uint32_t us100 = _ticks_us100(_profile_slowest[0]->ticks);
+
+        dbgio_printf("\n""slowest cmd %u %lu.%02lu us\n"
+                     "%lu steps %lu samples\n",
+                     _profile_slowest[0]->index,
+                     us100 / 100,
+                     us100 % 100,
+                     _profile.count,
+                     _profile.samples);
+}
+
+/* FRT ticks from the list reaching the VDP1 to the end of its drawing */
+static uint32_t
+_draw_ticks_get(void)
+{
+        const uint16_t end_index = ORDER_PRIMITIVE_INDEX + _primitive.count;
+
+        timer_phase_mark(TIMER_PHASE_LIST_PUT);
+        vdp1_sync_cmdt_list_put(_cmdt_lists[0], 0);
+        timer_phase_mark(TIMER_PHASE_DRAW_START);
+        vdp1_sync_render();
+        vdp1_sync();
+        while(vdp1_cmdt_current_get() != end_index) {}
+        timer_phase_mark(TIMER_PHASE_DRAW_END);
+        vdp1_sync_wait();
+
+        return timer_phase_ticks_get(TIMER_PHASE_DRAW_START, TIMER_PHASE_DRAW_END);
+}
+
+/* Same frame as _draw_ticks_get, sampled command by command */
+static void
+_draw_profile(void)
+{
+        vdp1_sync_cmdt_list_put(_cmdt_lists[0], 0);
+        vdp1_sync_render();
+        vdp1_sync();
+        profile_run(&_profile, ORDER_PRIMITIVE_INDEX + _primitive.count);
+        vdp1_sync_wait();
+
+        _profile_slowest_count = profile_slowest_get(&_profile,
+            _profile_slowest, PROFILE_SLOWEST_COUNT);
+}
+
+/* Stream the sizes of the zoom texture, raw and compressed, then the time
+ * to get it into VDP1 VRAM by each method and the rate in decoded bytes */
+static void
+_decompress_sweep(void)
+{
+        harness_t harness;
+        harness_stats_t ticks;
+        harness_stats_t stats;
+        char name[48];
+        uint32_t method;
+
+        const uint32_t size = decompress_raw_size_get();
+
+        (void)memset(&stats, 0x00, sizeof(stats));
+
+        stats.count = 1;
+        stats.min = stats.median = stats.max = stats.mean = size * 100;
+        report_stats("texture load size", "raw", "bytes", &stats);
+
+        stats.min = stats.median = stats.max = stats.mean =
+            decompress_compressed_size_get() * 100;
+        report_stats("texture load size", "ctex", "bytes", &stats);
+
+        for (method = 0; method < DECOMPRESS_METHOD_COUNT; method++) {
+                harness_init(&harness, TIMING_WARMUP, TIMING_REPETITIONS);
+
+                while (!harness_sample_add(&harness,
+                        decompress_ticks_get(method))) {
+                }
+
+                harness_stats_get(&harness, &ticks);
+
+                (void)snprintf(name, sizeof(name), "texture load %s",
+                    decompress_method_name_get(method));
+
+                _stats_us_get(&ticks, 0, &stats);
+                report_stats(name, "ZOOM", "us", &stats);
+
+                _stats_rate_get(&ticks, size, &stats);
+                report_stats(name, "ZOOM", "kB/s", &stats);
+        }
+}
+
+/* Stream the time to move lists of every size into VDP1 VRAM, by every
+ * method. The uploads overwrite all of VDP1 VRAM, which is set up again
+ * afterwards */
+static void
+_upload_sweep(void)
+{
+        harness_t harness;
+        harness_stats_t ticks;
+        harness_stats_t stats;
+        char name[48];
+        char variant[8];
+        uint32_t i;
+        uint32_t method;
+
+        for (i = 0; i < UPLOAD_COUNT_STEPS; i++) {
+                const uint32_t count = _upload_counts[i];
+
+                for (method = 0; method < UPLOAD_METHOD_COUNT; method++) {
+                        harness_init(&harness, TIMING_WARMUP, TIMING_REPETITIONS);
+
+                        while (!harness_sample_add(&harness,
+                                upload_ticks_get(method, count))) {
+                        }
+
+                        harness_stats_get(&harness, &ticks);
+
+                        (void)snprintf(name, sizeof(name), "upload %s",
+                            upload_method_name_get(method));
+                        (void)snprintf(variant, sizeof(variant), "x%lu", count);
+
+                        _stats_us_get(&ticks, 0, &stats);
+                        report_stats(name, variant, "us", &stats);
+
+                        _stats_rate_get(&ticks, (uint64_t)count * 1000, &stats);
+                        report_stats(name, variant, "cmd/s", &stats);
+
+                        _stats_rate_get(&ticks, (uint64_t)count * sizeof(vdp1_cmdt_t), &stats);
+                        report_stats(name, variant, "kB/s", &stats);
+                }
+        }
+
+        _decompress_sweep();
+
+        texture_init(&_vdp1_vram_partitions);
+        _gouraud_table_init();
+}
+
+static void
+_framebuffer_stats_get(harness_stats_t *stats, uint32_t (*ticks_get)(void))
+{
+        harness_t harness;
+
+        harness_init(&harness, TIMING_WARMUP, TIMING_REPETITIONS);
+
+        while (!harness_sample_add(&harness, ticks_get())) {
+        }
+
+        harness_stats_get(&harness, stats);
+}
+
+/* Stream the erase time of every framebuffer mode and erase window, the
+ * pixels erased per cycle beyond the smallest window, and the pixels
+ * filled per cycle by full screen polygons. The erase runs in VBlank, so
+ * no rate is given for a window that did not fit in it. The display is
+ * set back afterwards */
 static void
-_frt_ovi_handler(void)
+_framebuffer_sweep(void)
 {
-        _frt_ovf_count++;
+        harness_stats_t ticks;
+        harness_stats_t stats;
+        char name[48];
+        char variant[8];
+        uint32_t mode;
+        uint32_t area;
+
+        for (mode = 0; mode < FRAMEBUFFER_MODE_COUNT; mode++) {
+                const framebuffer_mode_t * const fb_mode = framebuffer_mode_get(mode);
+
+                const uint16_t smallest_height = fb_mode->height / _erase_divisors[0];
+                uint32_t smallest_ticks = 0;
+                uint32_t vblank_ticks = 0;
+
+                (void)snprintf(name, sizeof(name), "erase %s", fb_mode->name);
+
+                for (area = 0; area < ERASE_AREA_COUNT; area++) {
+                        const uint16_t height = fb_mode->height / _erase_divisors[area];
+
+                        framebuffer_mode_set(fb_mode, height);
+
+                        if (area == 0) {
+                                _framebuffer_stats_get(&ticks, framebuffer_vblank_ticks_get);
+
+                                vblank_ticks = ticks.median;
+                        }
+
+                        _framebuffer_stats_get(&ticks, framebuffer_change_ticks_get);
+
+                        (void)snprintf(variant, sizeof(variant), "1/%u",
+                            _erase_divisors[area]);
+
+                        _stats_us_get(&ticks, 0, &stats);
+                        report_stats(name, variant, "us", &stats);
+
+                        if (area == 0) {
+                                smallest_ticks = ticks.median;
+
+                                continue;
+                        }
+
+                        if (ticks.max >= vblank_ticks) {
+                                continue;
+                        }
+
+                        _stats_per_cycle_get(&ticks, smallest_ticks,
+                            (uint64_t)fb_mode->width * (height - smallest_height), &stats);
+                        report_stats(name, variant, "px/cycle", &stats);
+                }
+
+                (void)snprintf(name, sizeof(name), "fill %s", fb_mode->name);
+                (void)snprintf(variant, sizeof(variant), "x%u", FRAMEBUFFER_FILL_COUNT);
+
+                _framebuffer_stats_get(&ticks, framebuffer_fill_ticks_get);
+
+                _stats_us_get(&ticks, 0, &stats);
+                report_stats(name, variant, "us", &stats);
+
+                _stats_per_cycle_get(&ticks, 0, (uint64_t)FRAMEBUFFER_FILL_COUNT *
+                    fb_mode->width * fb_mode->height, &stats);
+                report_stats(name, variant, "px/cycle", &stats);
+        }
+
+        _display_init();
+
+        vdp2_sync();
+        vdp2_sync_wait();
 }
 
+/* Stream the cost of polygons inside, across and outside the system and
+ * user clipping windows, left to the VDP1 or culled by the CPU. The list
+ * build time counts, since culling moves work from the VDP1 to the CPU */
 static void
-_timing_start(void)
+_clipping_sweep(void)
 {
-        cpu_frt_count_set(0);
-        _frt_ovf_count = 0;
+        harness_t build_harness;
+        harness_t draw_harness;
+        harness_t harness;
+        harness_stats_t ticks;
+        harness_stats_t stats;
+        clipping_result_t result;
+        char name[48];
+        const char *variant;
+        uint32_t window;
+        uint32_t placement;
+        uint32_t reject;
+
+        for (window = 0; window < CLIPPING_WINDOW_COUNT; window++) {
+                for (placement = 0; placement < CLIPPING_PLACEMENT_COUNT; placement++) {
+                        (void)snprintf(name, sizeof(name), "clip %s %s x%u",
+                            clipping_window_name_get(window),
+                            clipping_placement_name_get(placement),
+                            CLIPPING_COUNT);
+
+                        for (reject = 0; reject < CLIPPING_REJECT_COUNT; reject++) {
+                                bool done;
+
+                                harness_init(&build_harness, TIMING_WARMUP, TIMING_REPETITIONS);
+                                harness_init(&draw_harness, TIMING_WARMUP, TIMING_REPETITIONS);
+                                harness_init(&harness, TIMING_WARMUP, TIMING_REPETITIONS);
+
+                                do {
+                                        clipping_run(window, placement, reject, &result);
+
+                                        (void)harness_sample_add(&build_harness, result.build_ticks);
+                                        (void)harness_sample_add(&draw_harness, result.draw_ticks);
+                                        done = harness_sample_add(&harness,
+                                            result.build_ticks + result.draw_ticks);
+                                } while (!done);
+
+                                variant = clipping_reject_name_get(reject);
+
+                                harness_stats_get(&harness, &ticks);
+                                _stats_us_get(&ticks, 0, &stats);
+                                report_stats(name, variant, "us", &stats);
+
+                                harness_stats_get(&build_harness, &ticks);
+                                _stats_us_get(&ticks, 0, &stats);
+                                report_stats(name, variant, "build us", &stats);
+
+                                harness_stats_get(&draw_harness, &ticks);
+                                _stats_us_get(&ticks, 0, &stats);
+                                report_stats(name, variant, "draw us", &stats);
+                        }
+                }
+        }
+}
+
+/* One frame whose list is rebuilt, in FRT ticks. The CPU is idle while it
+ * waits for the end of the drawing */
+static uint32_t
+_pipeline_frame(uint32_t mode, uint32_t *buffer, uint32_t *cpu_idle_ticks)
+{
+        const uint16_t end_index = ORDER_PRIMITIVE_INDEX + _primitive.count;
+        const uint32_t start = timer_ticks_get();
+
+        if (mode == PIPELINE_MODE_SERIAL) {
+                _primitive_init(_cmdt_lists[*buffer]);
+        }
+
+        vdp1_sync_cmdt_list_put(_cmdt_lists[*buffer], 0);
+        vdp1_sync_render();
+        vdp1_sync();
+
+        if (mode == PIPELINE_MODE_PIPELINED) {
+                *buffer ^= 1;
+
+                _primitive_init(_cmdt_lists[*buffer]);
+        }
+
+        const uint32_t wait_start = timer_ticks_get();
+        while (vdp1_cmdt_current_get() != end_index) {
+        }
+        *cpu_idle_ticks = timer_ticks_get() - wait_start;
+
+        vdp1_sync_wait();
+
+        return timer_ticks_get() - start;
 }
 
-static fix16_t
-_timing_get(void)
+/* Stream the frame rate of a pipeline mode, and the time the CPU and the
+ * VDP1 each spent idle in a frame. The VDP1 is idle for whatever part of
+ * the frame exceeds the drawing time measured by the sweep */
+static void
+_pipeline_measure(uint32_t mode)
 {
-        const uint32_t ticks_rem = cpu_frt_count_get();
+        harness_t frame_harness;
+        harness_t cpu_harness;
+        harness_stats_t frame_stats;
+        harness_stats_t cpu_stats;
+        harness_stats_t stats;
+        uint32_t buffer = 0;
+        char name[48];
+        char variant[24];
+        bool done;
+
+        const uint32_t draw_ticks =
+            _sweep_ticks[_primitive.count_step] + _empty_ticks;
+
+        harness_init(&frame_harness, TIMING_WARMUP, TIMING_REPETITIONS);
+        harness_init(&cpu_harness, TIMING_WARMUP, TIMING_REPETITIONS);
 
-        const uint32_t overflow_count =
-            ((65536 / MS_VALUE) * _frt_ovf_count);
+        /* The first pipelined frame draws a list built beforehand */
+        _primitive_init(_cmdt_lists[buffer]);
 
-        const uint32_t total_ticks =
-            (fix16_int32_from(overflow_count) + (fix16_int32_from(ticks_rem) / MS_VALUE));
+        do {
+                uint32_t cpu_idle_ticks;
 
-        return total_ticks;
+                const uint32_t ticks = _pipeline_frame(mode, &buffer, &cpu_idle_ticks);
+
+                done = harness_sample_add(&frame_harness, ticks);
+                (void)harness_sample_add(&cpu_harness, cpu_idle_ticks);
+        } while (!done);
+
+        _primitive_name_get(name, sizeof(name), variant, sizeof(variant));
+        (void)strcat(variant, " ");
+        (void)strcat(variant, _pipeline_mode_strings[mode]);
+
+        harness_stats_get(&frame_harness, &frame_stats);
+        _stats_rate_get(&frame_stats, 1000, &stats);
+        report_stats(name, variant, "frame/s", &stats);
+
+        _pipeline_fps100[mode] = stats.median;
+
+        harness_stats_get(&cpu_harness, &cpu_stats);
+        _stats_us_get(&cpu_stats, 0, &stats);
+        report_stats(name, variant, "cpu idle us", &stats);
+
+        _stats_us_get(&frame_stats, draw_ticks, &stats);
+        report_stats(name, variant, "vdp1 idle us", &stats);
 }
 
 void
@@ -149,28 +1037,91 @@ main(void)
         dbgio_dev_font_load();
 
         _cmdt_list_init();
-        _primitive_init();
-        cpu_frt_init(CPU_FRT_CLOCK_DIV_8);
-        cpu_frt_ovi_set(_frt_ovi_handler);
+        framebuffer_init();
+        clipping_init();
+        /* The first table stays shared */
+        gouraud_init(_vdp1_vram_partitions.gouraud_base + 1, GOURAUD_COUNT_MAX - 1);
+        texture_init(&_vdp1_vram_partitions);
+        timer_init(CPU_FRT_INTERRUPT_PRIORITY_LEVEL);
+        static struct timer console_timer = {
+                .delay = TIMER_MS(CONSOLE_REFRESH_MS),
+                .period = TIMER_MS(CONSOLE_REFRESH_MS),
+                .callback = _console_timer_handler
+        };
+        (void)timer_add(&console_timer);
+        report_init("vdp1Perf");
+        _primitive.type = PRIMITIVE_TYPE_POLYLINE;
+        _primitive.draw_mode = PRIMITIVE_DRAW_MODE_NORMAL;
+        _primitive.size_step = 0;
+        _primitive.color_mode = TEXTURE_COLOR_MODE_4BPP;
+        _primitive.gouraud = PRIMITIVE_GOURAUD_SHARED;
+        _primitive.count_step = -1;
+        _primitive_init(_cmdt_lists[0]);
+        harness_init(&_harness, TIMING_WARMUP, TIMING_REPETITIONS);
+        report_pass_begin();
+        _upload_sweep();
+        _framebuffer_sweep();
+        _clipping_sweep();
         while(true) {
-          _timing_start();
-          vdp1_sync_cmdt_list_put(_cmdt_list, 0);
-          fix16_t frt_count = _timing_get();
-          vdp1_sync_render();
-          vdp1_sync();
-          while(vdp1_cmdt_current_get() != ORDER_DRAW_END_INDEX) {}
-          frt_count = _timing_get() - frt_count;
-          vdp1_sync_wait();
-          dbgio_puts("[1;1H[2J");
-          dbgio_printf("\n""0x%x %x Done\n", NB_CMD, frt_count);
-          dbgio_flush();
+          uint32_t ticks = _draw_ticks_get();
+          if (_primitive.count != 0) {
+            ticks = (ticks > _empty_ticks) ? (ticks - _empty_ticks) : 0;
+          }
+          if (harness_sample_add(&_harness, ticks)) {
+            harness_stats_get(&_harness, &_harness_stats);
+            _timing_report();
+            _gouraud_report();
+            if (_primitive.count == 0) {
+              _empty_ticks = _harness_stats.median;
+            } else {
+              _sweep_ticks[_primitive.count_step] = _harness_stats.median;
+              _draw_profile();
+              _profile_report();
+              _pipeline_measure(PIPELINE_MODE_SERIAL);
+              _pipeline_measure(PIPELINE_MODE_PIPELINED);
+            }
+            if (_sweep_next()) {
+              report_pass_begin();
+              _upload_sweep();
+              _framebuffer_sweep();
+              _clipping_sweep();
+            }
+            _primitive_init(_cmdt_lists[0]);
+            harness_init(&_harness, TIMING_WARMUP, TIMING_REPETITIONS);
+          }
+          if (_console_refresh) {
+            _console_refresh = false;
+            _sweep_print();
+            dbgio_flush();
+          }
           vdp2_sync();
           vdp2_sync_wait();
+          timer_phase_mark(TIMER_PHASE_VBLANK);
         }
 }
 
 void
 user_init(void)
+{
+        _display_init();
+
+        cpu_intc_mask_set(0);
+
+        /* The largest list and a gouraud table for each of its polygons do
+         * not fit the default partitions, so the texture area gives up the
+         * difference */
+        vdp1_vram_partitions_set(ORDER_COUNT_MAX,
+            VDP1_VRAM_DEFAULT_TEXTURE_SIZE -
+            ((ORDER_COUNT_MAX - VDP1_VRAM_DEFAULT_CMDT_COUNT) * sizeof(vdp1_cmdt_t)) -
+            ((GOURAUD_COUNT_MAX - VDP1_VRAM_DEFAULT_GOURAUD_COUNT) * sizeof(vdp1_gouraud_table_t)),
+            GOURAUD_COUNT_MAX,
+            VDP1_VRAM_DEFAULT_CLUT_COUNT);
+
+        vdp1_vram_partitions_get(&_vdp1_vram_partitions);
+}
+
+static void
+_display_init(void)
 {
         vdp2_tvmd_display_res_set(VDP2_TVMD_INTERLACE_NONE, VDP2_TVMD_HORZ_NORMAL_A,
             VDP2_TVMD_VERT_224);
@@ -185,12 +1136,7 @@ user_init(void)
 
         vdp1_env_set(&env);
 
-        cpu_intc_mask_set(0);
-
         vdp2_tvmd_display_set();
-
-        vdp1_vram_partitions_get(&_vdp1_vram_partitions);
-
 }
 
 static void
@@ -200,39 +1146,40 @@ _cmdt_list_init(void)
             INT16_VEC2_INITIALIZER(SCREEN_WIDTH - 1,
                                       SCREEN_HEIGHT - 1);
 
-        _cmdt_list = vdp1_cmdt_list_alloc(ORDER_COUNT);
+        static const int16_vec2_t local_coord =
+            INT16_VEC2_INITIALIZER(0, 0);
 
-        (void)memset(&_cmdt_list->cmdts[0], 0x00,
-            sizeof(vdp1_cmdt_t) * ORDER_COUNT);
+        for (uint32_t buffer = 0; buffer < PIPELINE_BUFFER_COUNT; buffer++) {
+                vdp1_cmdt_list_t * const cmdt_list =
+                    vdp1_cmdt_list_alloc(ORDER_COUNT_MAX);
 
-        _cmdt_list->count = ORDER_COUNT;
+                _cmdt_lists[buffer] = cmdt_list;
 
-        vdp1_cmdt_t *cmdts;
-        cmdts = &_cmdt_list->cmdts[0];
+                (void)memset(&cmdt_list->cmdts[0], 0x00,
+                    sizeof(vdp1_cmdt_t) * ORDER_COUNT_MAX);
 
-        vdp1_cmdt_system_clip_coord_set(&cmdts[ORDER_SYSTEM_CLIP_COORDS_INDEX]);
-        vdp1_cmdt_param_vertex_set(&cmdts[ORDER_SYSTEM_CLIP_COORDS_INDEX],
-            CMDT_VTX_SYSTEM_CLIP,
-            &system_clip_coord);
+                vdp1_cmdt_t *cmdts;
+                cmdts = &cmdt_list->cmdts[0];
 
-        vdp1_cmdt_end_set(&cmdts[ORDER_DRAW_END_INDEX]);
-}
+                vdp1_cmdt_system_clip_coord_set(&cmdts[ORDER_SYSTEM_CLIP_COORDS_INDEX]);
+                vdp1_cmdt_param_vertex_set(&cmdts[ORDER_SYSTEM_CLIP_COORDS_INDEX],
+                    CMDT_VTX_SYSTEM_CLIP,
+                    &system_clip_coord);
 
-static void
-_primitive_init(void)
-{
-        static const int16_vec2_t local_coord_center =
-            INT16_VEC2_INITIALIZER((SCREEN_WIDTH / 2) - PRIMITIVE_HALF_WIDTH - 1,
-                                      (SCREEN_HEIGHT / 2) - PRIMITIVE_HALF_HEIGHT - 1);
+                vdp1_cmdt_t *cmdt_local_coords;
+                cmdt_local_coords = &cmdts[ORDER_LOCAL_COORDS_INDEX];
 
-        vdp1_cmdt_t *cmdt_local_coords;
-        cmdt_local_coords = &_cmdt_list->cmdts[ORDER_LOCAL_COORDS_INDEX];
-
-        vdp1_cmdt_local_coord_set(cmdt_local_coords);
-        vdp1_cmdt_param_vertex_set(cmdt_local_coords, CMDT_VTX_LOCAL_COORD,
-            &local_coord_center);
+                vdp1_cmdt_local_coord_set(cmdt_local_coords);
+                vdp1_cmdt_param_vertex_set(cmdt_local_coords, CMDT_VTX_LOCAL_COORD,
+                    &local_coord);
+        }
 
+        _gouraud_table_init();
+}
 
+static void
+_gouraud_table_init(void)
+{
         vdp1_gouraud_table_t *gouraud_base;
         gouraud_base = _vdp1_vram_partitions.gouraud_base;
 
@@ -240,32 +1187,176 @@ _primitive_init(void)
         gouraud_base->colors[1] = COLOR_RGB1555(1,  0, 31,  0);
         gouraud_base->colors[2] = COLOR_RGB1555(1,  0,  0, 31);
         gouraud_base->colors[3] = COLOR_RGB1555(1, 31, 31, 31);
+}
+
+static void
+_primitive_size_init(void)
+{
+        if (!PRIMITIVE_TYPE_SPRITE(_primitive.type)) {
+                _primitive.width = _primitive_sizes[_primitive.size_step];
+                _primitive.height = _primitive.width;
+                _primitive.texels = 0;
+
+                return;
+        }
 
-        for (int i = 0; i<NB_CMD; i++){
+        const uint32_t zoom = _sprite_zooms[_primitive.size_step];
+
+        uint32_t texture_height = ((SCREEN_HEIGHT - 4) * 4) / zoom;
+
+        if (texture_height > TEXTURE_HEIGHT) {
+                texture_height = TEXTURE_HEIGHT;
+        }
+
+        _primitive.width = (TEXTURE_WIDTH * zoom) / 4;
+        _primitive.height = (texture_height * zoom) / 4;
+        _primitive.texels = TEXTURE_WIDTH * texture_height;
+}
+
+static void
+_sprite_init(vdp1_cmdt_t *cmdt)
+{
+        const texture_t * const texture = texture_get(_primitive.color_mode);
+
+        vdp1_cmdt_draw_mode_t draw_mode = _primitive_draw_modes[_primitive.draw_mode];
+
+        /* The 4bpp texture uses every code, 0xF included */
+        draw_mode.bits.color_mode = texture->color_mode;
+        draw_mode.bits.end_code_disable = true;
+
+        vdp1_cmdt_param_draw_mode_set(cmdt, draw_mode);
+        vdp1_cmdt_param_color_set(cmdt, texture->colr);
+        vdp1_cmdt_param_char_base_set(cmdt, texture->char_base);
+        vdp1_cmdt_param_size_set(cmdt, TEXTURE_WIDTH,
+            _primitive.texels / TEXTURE_WIDTH);
+
+        /* Vertices go clockwise from the upper left corner */
+        switch (_primitive.type) {
+        case PRIMITIVE_TYPE_NORMAL_SPRITE:
+                vdp1_cmdt_param_vertex_set(cmdt, CMDT_VTX_NORMAL_SPRITE,
+                    &_primitive.points[0]);
+                vdp1_cmdt_normal_sprite_set(cmdt);
+                break;
+        case PRIMITIVE_TYPE_SCALED_SPRITE:
+                vdp1_cmdt_param_vertex_set(cmdt, CMDT_VTX_SCALE_SPRITE_UL,
+                    &_primitive.points[0]);
+                vdp1_cmdt_param_vertex_set(cmdt, CMDT_VTX_SCALE_SPRITE_LR,
+                    &_primitive.points[2]);
+                vdp1_cmdt_scaled_sprite_set(cmdt);
+                break;
+        default:
+                vdp1_cmdt_param_vertices_set(cmdt, &_primitive.points[0]);
+                vdp1_cmdt_distorted_sprite_set(cmdt);
+                break;
+        }
+}
+
+/* Give each polygon its own table when the configuration asks for it. The
+ * previous tables are freed last first, so that every polygon gets the
+ * same table back */
+static void
+_gouraud_tables_init(void)
+{
+        uint32_t i;
+
+        while (_gouraud_table_count > 0) {
+                _gouraud_table_count--;
+
+                gouraud_free(_gouraud_tables[_gouraud_table_count]);
+        }
+
+        if (_primitive.gouraud != PRIMITIVE_GOURAUD_OWN) {
+                return;
+        }
+
+        for (i = 0; i < _primitive.count; i++) {
+                vdp1_gouraud_table_t * const table = gouraud_alloc();
+
+                if (table == NULL) {
+                        break;
+                }
+
+                table->colors[0] = COLOR_RGB1555(1, i % 32, 0, 0);
+                table->colors[1] = COLOR_RGB1555(1, 0, i % 32, 0);
+                table->colors[2] = COLOR_RGB1555(1, 0, 0, i % 32);
+                table->colors[3] = COLOR_RGB1555(1, 31, 31, 31);
+
+                _gouraud_tables[i] = table;
+                _gouraud_table_count++;
+        }
+}
+
+/* Rebuild a command list for the current configuration. Primitives are
+ * spread over the screen so that none of them is clipped */
+static void
+_primitive_init(vdp1_cmdt_list_t *cmdt_list)
+{
+        _primitive_size_init();
+
+        const int16_t width = _primitive.width;
+        const int16_t height = _primitive.height;
+
+        _primitive.count = (_primitive.count_step < 0) ? 0 : (1 << _primitive.count_step);
+
+        cmdt_list->count = ORDER_PRIMITIVE_INDEX + _primitive.count + 1;
+
+        vdp1_gouraud_table_t *gouraud_base;
+        gouraud_base = _vdp1_vram_partitions.gouraud_base;
+
+        _gouraud_tables_init();
+
+        for (int i = 0; i<_primitive.count; i++){
           vdp1_cmdt_t *cmdt_polygon;
-          cmdt_polygon = &_cmdt_list->cmdts[ORDER_POLYGON_INDEX+i];
+          cmdt_polygon = &cmdt_list->cmdts[ORDER_PRIMITIVE_INDEX+i];
+
+          const int16_t x = (i * 7) % (SCREEN_WIDTH - width);
+          const int16_t y = (i * 13) % (SCREEN_HEIGHT - height);
+
+          if (PRIMITIVE_TYPE_SPRITE(_primitive.type)) {
+            _primitive.points[0].x = x;
+            _primitive.points[0].y = y;
 
-          _primitive.type = PRIMITIVE_TYPE_POLYLINE;
-          _primitive.draw_mode = PRIMITIVE_DRAW_MODE_NORMAL;
+            _primitive.points[1].x = x + width - 1;
+            _primitive.points[1].y = y;
+
+            _primitive.points[2].x = x + width - 1;
+            _primitive.points[2].y = y + height - 1;
+
+            _primitive.points[3].x = x;
+            _primitive.points[3].y = y + height - 1;
+
+            _sprite_init(cmdt_polygon);
+            continue;
+          }
 
           _primitive.color = COLOR_RGB1555(1, (31+i)%32, (0+i)%32, (31+i)%32);
 
-          _primitive.points[0].x = (i - NB_CMD/2);
-          _primitive.points[0].y = PRIMITIVE_HEIGHT - 1 + (i - NB_CMD/2);
+          _primitive.points[0].x = x;
+          _primitive.points[0].y = y + height - 1;
 
-          _primitive.points[1].x = PRIMITIVE_WIDTH - 1 + (i - NB_CMD/2);
-          _primitive.points[1].y = PRIMITIVE_HEIGHT - 1 + (i - NB_CMD/2);
+          _primitive.points[1].x = x + width - 1;
+          _primitive.points[1].y = y + height - 1;
 
-          _primitive.points[2].x = PRIMITIVE_WIDTH - 1 + (i - NB_CMD/2);
-          _primitive.points[2].y = (i - NB_CMD/2);
+          _primitive.points[2].x = x + width - 1;
+          _primitive.points[2].y = y;
 
-          _primitive.points[3].x = (i - NB_CMD/2);
-          _primitive.points[3].y = (i - NB_CMD/2);
+          _primitive.points[3].x = x;
+          _primitive.points[3].y = y;
 
           vdp1_cmdt_param_color_set(cmdt_polygon, _primitive.color);
           vdp1_cmdt_param_draw_mode_set(cmdt_polygon, _primitive_draw_modes[_primitive.draw_mode]);
           vdp1_cmdt_param_vertices_set(cmdt_polygon, &_primitive.points[0]);
-          vdp1_cmdt_param_gouraud_base_set(cmdt_polygon, (uint32_t)gouraud_base);
-          vdp1_cmdt_polygon_set(cmdt_polygon);
+          if ((uint32_t)i < _gouraud_table_count) {
+            vdp1_cmdt_param_gouraud_base_set(cmdt_polygon, (uint32_t)_gouraud_tables[i]);
+          } else {
+            vdp1_cmdt_param_gouraud_base_set(cmdt_polygon, (uint32_t)gouraud_base);
+          }
+          if (_primitive.type == PRIMITIVE_TYPE_POLYLINE) {
+            vdp1_cmdt_polyline_set(cmdt_polygon);
+          } else {
+            vdp1_cmdt_polygon_set(cmdt_polygon);
+          }
         }
-}
\ No newline at end of file
+
+        vdp1_cmdt_end_set(&cmdt_list->cmdts[ORDER_PRIMITIVE_INDEX + _primitive.count]);
+}